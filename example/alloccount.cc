@@ -0,0 +1,185 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/eventloop_thread.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 跨线程提交回调和跨线程send的堆分配次数 替换全局operator new计数
+//   queueInLoop/runInLoop 捕获shared_ptr和几个参数的回调，和TcpConnection内部提交的一样大
+//   send(std::string&&)   其他线程发送已经构造好的消息，消息移交给连接所在的loop
+// 预热一轮（第一次提交会注册生产者的环形队列）之后再计数，断言为0
+// 每批kBatch个，等执行完（客户端读完）再提交下一批：环形队列满了之后的overflow、
+// 输出队列积压时的分段是另外的退化路径，不在这里计数
+// 用法：./alloccount [每轮次数=100000]
+
+static std::atomic<long> g_allocations(0);
+static const int kBatch = 256;
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+// 提交n个回调并等它们执行完，返回期间的分配次数
+static long countQueueInLoop(EventLoop *loop, int n)
+{
+    std::shared_ptr<int> token(new int(0)); // 代替TcpConnectionPtr
+    std::atomic<int> executed(0);
+    long before = g_allocations.load();
+    for (int i = 0; i < n; i++)
+    {
+        if (i % 2 == 0)
+        {
+            loop->queueInLoop([token, &executed, i]() {
+                executed.fetch_add(1);
+                (void)i;
+            });
+        }
+        else
+        {
+            loop->runInLoop([token, &executed]() { executed.fetch_add(1); });
+        }
+        if ((i + 1) % kBatch == 0 || i + 1 == n)
+        {
+            while (executed.load() < i + 1)
+            {
+                usleep(100);
+            }
+        }
+    }
+    return g_allocations.load() - before;
+}
+
+// 从其他线程发送n条已经构造好的消息，客户端读完之后返回期间的分配次数
+static long countSend(const TcpConnectionPtr &conn, int clientfd, int n)
+{
+    const size_t kMessageSize = 64;
+    std::vector<std::string> messages(n, std::string(kMessageSize, 'x'));
+    long before = g_allocations.load();
+    std::atomic<size_t> received(0);
+    std::thread reader([clientfd, n, kMessageSize, &received]() {
+        char buf[65536];
+        while (received.load() < n * kMessageSize)
+        {
+            ssize_t len = ::read(clientfd, buf, sizeof buf);
+            if (len <= 0)
+            {
+                break;
+            }
+            received.fetch_add(len);
+        }
+    });
+    // 线程本身要分配，不算在内
+    long threadAllocations = g_allocations.load() - before;
+    for (int i = 0; i < n; i++)
+    {
+        conn->send(std::move(messages[i]));
+        if ((i + 1) % kBatch == 0 || i + 1 == n)
+        {
+            while (received.load() < (i + 1) * kMessageSize)
+            {
+                usleep(100);
+            }
+        }
+    }
+    reader.join();
+    return g_allocations.load() - before - threadAllocations;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    Logger::setLogLevel(ERROR);
+
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    countQueueInLoop(loop, n);
+    long functorAllocations = countQueueInLoop(loop, n);
+    printf("queueInLoop/runInLoop x%d: %ld allocations\n", n, functorAllocations);
+
+    EventLoop baseLoop;
+    InetAddress addr(9988);
+    TcpServer server(&baseLoop, addr, "AllocCount");
+    TcpConnectionPtr connection;
+    std::atomic<bool> connected(false);
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            connection = conn;
+            connected = true;
+        }
+    });
+    server.setThreadNum(1);
+    server.start();
+
+    long sendAllocations = -1;
+    std::thread sender([&]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9988);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) == 0)
+        {
+            while (!connected)
+            {
+                usleep(1000);
+            }
+            countSend(connection, fd, n / 10);
+            sendAllocations = countSend(connection, fd, n);
+        }
+        ::close(fd);
+        baseLoop.runInLoop([&]() { baseLoop.quit(); });
+    });
+    baseLoop.loop();
+    sender.join();
+    printf("send(std::string&&) from another thread x%d: %ld allocations\n", n, sendAllocations);
+
+    assert(functorAllocations == 0);
+    assert(sendAllocations == 0);
+    return functorAllocations == 0 && sendAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 读大的长度前缀消息的吞吐：64KB到16MB，收到消息头以后调不调用Buffer::reserve
+// 每种配置一个新连接：客户端先发1字节（是否reserve）和4字节总MB数，然后连续发消息，
+// 服务端收完之后回1字节，客户端计时
+// 用法：./bigmsgbench [每种配置的总MB数=512]
+
+int main(int argc, char *argv[])
+{
+    uint32_t totalMb = argc > 1 ? atoi(argv[1]) : 512;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    InetAddress addr(9986);
+    TcpServer server(&loop, addr, "BigMsgBench");
+    // 配置是一个接一个跑的，同时只有一个连接
+    bool configured = false;
+    bool useReserve = false;
+    size_t total = 0;
+    size_t received = 0;
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            configured = false;
+            received = 0;
+        }
+    });
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        if (!configured)
+        {
+            if (buf->readableBytes() < 5)
+            {
+                return;
+            }
+            useReserve = buf->readInt8() != 0;
+            total = static_cast<size_t>(buf->readInt32()) << 20;
+            configured = true;
+        }
+        while (buf->readableBytes() >= 4)
+        {
+            size_t len = static_cast<size_t>(buf->peekInt32());
+            if (buf->readableBytes() < 4 + len)
+            {
+                if (useReserve)
+                {
+                    buf->reserve(4 + len - buf->readableBytes());
+                }
+                break;
+            }
+            buf->retrieve(4 + len);
+            received += 4 + len;
+        }
+        if (received >= total)
+        {
+            conn->send("k", 1);
+        }
+    });
+    server.start();
+
+    std::thread client([&]() {
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9986);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+
+        const size_t sizes[] = {64 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024};
+        printf("%-10s %-8s %10s\n", "message", "reserve", "MB/s");
+        for (size_t size : sizes)
+        {
+            std::vector<char> frame(4 + size, 'x');
+            uint32_t be32 = htonl(static_cast<uint32_t>(size));
+            memcpy(frame.data(), &be32, sizeof be32);
+            size_t frames = ((static_cast<size_t>(totalMb) << 20) + frame.size() - 1) / frame.size();
+            for (int reserve = 0; reserve <= 1; reserve++)
+            {
+                int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                if (::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+                {
+                    perror("connect");
+                    exit(1);
+                }
+                char hello[5];
+                hello[0] = static_cast<char>(reserve);
+                be32 = htonl(totalMb);
+                memcpy(hello + 1, &be32, sizeof be32);
+                ::write(fd, hello, sizeof hello);
+
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < frames; i++)
+                {
+                    size_t offset = 0;
+                    while (offset < frame.size())
+                    {
+                        ssize_t n = ::write(fd, frame.data() + offset, frame.size() - offset);
+                        if (n <= 0)
+                        {
+                            perror("write");
+                            exit(1);
+                        }
+                        offset += n;
+                    }
+                }
+                char ack;
+                ::read(fd, &ack, 1);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printf("%-10zu %-8s %10.0f\n", size, reserve ? "yes" : "no", frames * frame.size() / seconds / 1e6);
+                ::close(fd);
+            }
+        }
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -38,9 +38,11 @@ private:
                    Buffer *buf,                  // 缓冲区
                    Timestamp time)               // 接收到数据的事件信息
     {
-        string s = buf->retrieveAllAsString();
-        cout << "recv data: " << s << "time: " << time.toString() << endl;
-        conn->send(s);
+        // 直接输出和回发Buffer里的数据，不先拷贝成string
+        cout << "recv data: ";
+        cout.write(buf->peek(), buf->readableBytes());
+        cout << "time: " << time.toString() << endl;
+        conn->send(buf);
     }
 
     // 专门处理用户的连接和断开 epoll listenfd
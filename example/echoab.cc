@@ -0,0 +1,155 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// echo服务的A/B：EpollPoller、IoUringPoller（就绪通知）、IoUringPoller+完成式I/O
+// 客户端每一轮给每个连接写64字节，再把每个连接的回显读完
+// polls/msg是每条消息平均的poll次数：EpollPoller每次poll都是一次epoll_wait，
+// IoUringPoller的CQ里已经有事件时poll不进入内核，所以是系统调用次数的上限
+// 用法：./echoab [总消息数=200000]
+// 需要 ulimit -n 大于最大连接数的两倍
+
+struct Config
+{
+    const char *name;
+    EventLoop::PollerType poller;
+    bool completionIo;
+};
+
+static void runConfig(const Config &config, int conns, long totalMessages, uint16_t port)
+{
+    EventLoop loop(config.poller);
+    InetAddress addr(port);
+    TcpServer server(&loop, addr, "EchoAB");
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([](const TcpConnectionPtr &) {});
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+    server.setCompletionIo(config.completionIo);
+    server.start();
+
+    Poller::PollStats before;
+    Poller::PollStats after;
+    std::thread client([&]() {
+        std::vector<int> fds;
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+        for (int i = 0; i < conns; i++)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+            {
+                perror("connect");
+                exit(1);
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            fds.push_back(fd);
+        }
+        usleep(100000);
+
+        // poll统计只能在loop线程读
+        std::atomic<bool> captured(false);
+        loop.runInLoop([&]() {
+            before = loop.pollStats();
+            captured = true;
+        });
+        while (!captured)
+        {
+            usleep(100);
+        }
+
+        long rounds = totalMessages / conns;
+        char buf[64] = {0};
+        auto start = std::chrono::steady_clock::now();
+        for (long r = 0; r < rounds; r++)
+        {
+            for (int fd : fds)
+            {
+                ::write(fd, buf, sizeof buf);
+            }
+            for (int fd : fds)
+            {
+                size_t got = 0;
+                while (got < sizeof buf)
+                {
+                    ssize_t n = ::read(fd, buf, sizeof buf - got);
+                    if (n <= 0)
+                    {
+                        perror("read");
+                        exit(1);
+                    }
+                    got += n;
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        captured = false;
+        loop.runInLoop([&]() {
+            after = loop.pollStats();
+            captured = true;
+        });
+        while (!captured)
+        {
+            usleep(100);
+        }
+        double messages = static_cast<double>(rounds) * conns;
+        uint64_t polls = after.polls - before.polls;
+        uint64_t events = after.events - before.events;
+        printf("%-8d %-20s %12.0f %10.2f %12.2f\n", conns, config.name, messages / seconds,
+               polls / messages, polls ? static_cast<double>(events) / polls : 0.0);
+
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+}
+
+int main(int argc, char *argv[])
+{
+    long totalMessages = argc > 1 ? atol(argv[1]) : 200000;
+    Logger::setLogLevel(ERROR);
+
+    const int connCounts[] = {1, 10, 100, 1000};
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < 2 * 1000 + 64)
+    {
+        fprintf(stderr, "ulimit -n is %lu, need at least %d\n", static_cast<unsigned long>(rl.rlim_cur), 2 * 1000 + 64);
+        return 1;
+    }
+
+    const Config configs[] = {
+        {"epoll", EventLoop::kEpollPoller, false},
+        {"io_uring", EventLoop::kIoUringPoller, false},
+        {"io_uring+completion", EventLoop::kIoUringPoller, true},
+    };
+    printf("%-8s %-20s %12s %10s %12s\n", "conns", "poller", "msgs/s", "polls/msg", "events/poll");
+    uint16_t port = 9970;
+    for (int conns : connCounts)
+    {
+        for (const Config &config : configs)
+        {
+            runConfig(config, conns, totalMessages, port++);
+        }
+    }
+    return 0;
+}
@@ -38,8 +38,7 @@ private:
     // 可读写事件回调
     void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
+        conn->send(buf); // 把buf的数据整块交给连接，不拷贝成string
         conn->shutdown(); // 写端 EPOLLHUP ==> closeCallback
     }
 
@@ -0,0 +1,161 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/shared_slice.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 一对多推送：同一条消息发给所有订阅者，订阅者不读，消息积压在输出队列里
+// 对比每个连接send(std::string)各拷贝一份和send(SharedSlice)只保存引用的内存和耗时
+// 用法：./fanout [订阅者数=5000] [消息条数=32] [消息长度=1024] [共享=1]
+// 需要 ulimit -n 大于两倍订阅者数（客户端和服务端在同一个进程里）
+
+// accept出来的连接继承监听socket的SO_SNDBUF TcpServer不暴露监听fd，按端口找
+static void shrinkListenSendBuffer(uint16_t port, int sndbuf)
+{
+    for (int fd = 3; fd < 1024; fd++)
+    {
+        int listening = 0;
+        socklen_t optlen = sizeof listening;
+        sockaddr_in local;
+        socklen_t addrlen = sizeof local;
+        if (::getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &optlen) == 0 && listening &&
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&local), &addrlen) == 0 && ntohs(local.sin_port) == port)
+        {
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+        }
+    }
+}
+
+static long rssKb()
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    long kb = 0;
+    while (fp && fgets(line, sizeof line, fp))
+    {
+        if (strncmp(line, "VmRSS:", 6) == 0)
+        {
+            kb = atol(line + 6);
+        }
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return kb;
+}
+
+int main(int argc, char *argv[])
+{
+    int numSubscribers = argc > 1 ? atoi(argv[1]) : 5000;
+    int numMessages = argc > 2 ? atoi(argv[2]) : 32;
+    size_t messageSize = argc > 3 ? atoi(argv[3]) : 1024;
+    bool shared = argc > 4 ? atoi(argv[4]) != 0 : true;
+
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < static_cast<rlim_t>(numSubscribers) * 2 + 64)
+    {
+        fprintf(stderr, "ulimit -n is %lu, need at least %d\n", static_cast<unsigned long>(rl.rlim_cur), numSubscribers * 2 + 64);
+        return 1;
+    }
+    Logger::setLogLevel(ERROR);
+    // 订阅者关闭时队列里还有数据
+    ::signal(SIGPIPE, SIG_IGN);
+
+    EventLoop loop;
+    InetAddress addr(9989);
+    TcpServer server(&loop, addr, "FanOut");
+    std::vector<TcpConnectionPtr> subscribers;
+    std::atomic<int> connected(0);
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            subscribers.push_back(conn);
+            ++connected;
+        }
+    });
+    server.start();
+    // 内核的发送缓冲区很小，发出去的消息大部分留在服务端的输出队列里
+    shrinkListenSendBuffer(9989, 4096);
+
+    std::vector<int> clients;
+    std::thread client([&]() {
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9989);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+        for (int i = 0; i < numSubscribers; i++)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            int rcvbuf = 4096;
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+            if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+            {
+                perror("connect");
+                break;
+            }
+            clients.push_back(fd);
+        }
+        while (connected < static_cast<int>(clients.size()))
+        {
+            usleep(10000);
+        }
+
+        loop.runInLoop([&]() {
+            long baseline = rssKb();
+            std::string message(messageSize, 'x');
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < numMessages; i++)
+            {
+                message[0] = static_cast<char>('a' + i % 26);
+                if (shared)
+                {
+                    SharedSlice slice{std::string(message)};
+                    for (const TcpConnectionPtr &conn : subscribers)
+                    {
+                        conn->send(slice);
+                    }
+                }
+                else
+                {
+                    for (const TcpConnectionPtr &conn : subscribers)
+                    {
+                        conn->send(message);
+                    }
+                }
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            long rss = rssKb();
+            printf("%s subscribers=%zu messages=%d size=%zu: %.1f ms, %.0f ns/send, rss +%ldKB (%.0f bytes per subscriber)\n",
+                   shared ? "send(SharedSlice)" : "send(std::string)", subscribers.size(), numMessages, messageSize,
+                   ms, ms * 1e6 / (static_cast<double>(numMessages) * subscribers.size()), rss - baseline,
+                   subscribers.empty() ? 0.0 : (rss - baseline) * 1024.0 / subscribers.size());
+            subscribers.clear();
+        });
+
+        sleep(1);
+        for (int fd : clients)
+        {
+            ::close(fd);
+        }
+        loop.runAfter(1.0, [&]() { loop.quit(); });
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <mymuduo/poller.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Poller里fd->Channel登记表的微基准：原来的unordered_map<int, Channel*>和按fd下标的ChannelMap
+//   add    N个连接依次注册
+//   modify 按随机顺序查找（updateChannel修改事件、poll返回后按fd找Channel）
+//   churn  随机关掉一个连接再接入一个，内核复用最小的空闲fd，所以还是同一个fd
+//   remove 全部删除
+// 只测登记表本身，不包括epoll_ctl
+// 用法：./fdmapbench [轮数=10]
+
+// 通过子类拿到Poller的protected成员ChannelMap
+class FlatTable : public Poller
+{
+public:
+    FlatTable() : Poller(nullptr) {}
+
+    Timestamp poll(int, ChannelList *) override { return Timestamp(); }
+    void updateChannel(Channel *) override {}
+    void removeChannel(Channel *) override {}
+
+    Channel *find(int fd) const { return channels_.find(fd); }
+    void insert(int fd, Channel *channel) { channels_.insert(fd, channel); }
+    void erase(int fd) { channels_.erase(fd); }
+};
+
+class MapTable
+{
+public:
+    Channel *find(int fd) const
+    {
+        auto it = channels_.find(fd);
+        return it == channels_.end() ? nullptr : it->second;
+    }
+    void insert(int fd, Channel *channel) { channels_[fd] = channel; }
+    void erase(int fd) { channels_.erase(fd); }
+
+private:
+    std::unordered_map<int, Channel *> channels_;
+};
+
+struct Result
+{
+    double add, modify, churn, remove;
+};
+
+template <typename Table>
+static Result run(int n, int rounds, const std::vector<int> &order, std::vector<char> &dummy)
+{
+    using Clock = std::chrono::steady_clock;
+    const int kFirstFd = 16; // 监听socket、eventfd、timerfd之类占掉的小fd
+    Result result = {0, 0, 0, 0};
+    size_t sink = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        Table table;
+        auto t0 = Clock::now();
+        for (int i = 0; i < n; i++)
+        {
+            table.insert(kFirstFd + i, reinterpret_cast<Channel *>(&dummy[i]));
+        }
+        auto t1 = Clock::now();
+        for (int pass = 0; pass < 4; pass++)
+        {
+            for (int i : order)
+            {
+                sink += reinterpret_cast<size_t>(table.find(kFirstFd + i));
+            }
+        }
+        auto t2 = Clock::now();
+        for (int i : order)
+        {
+            table.erase(kFirstFd + i);
+            table.insert(kFirstFd + i, reinterpret_cast<Channel *>(&dummy[i]));
+        }
+        auto t3 = Clock::now();
+        for (int i = 0; i < n; i++)
+        {
+            table.erase(kFirstFd + i);
+        }
+        auto t4 = Clock::now();
+
+        result.add += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        result.modify += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        result.churn += std::chrono::duration<double, std::nano>(t3 - t2).count();
+        result.remove += std::chrono::duration<double, std::nano>(t4 - t3).count();
+    }
+    if (sink == 1)
+    {
+        printf("!");
+    }
+    double ops = static_cast<double>(n) * rounds;
+    result.add /= ops;
+    result.modify /= ops * 4;
+    result.churn /= ops;
+    result.remove /= ops;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    const int sizes[] = {1000, 10000, 100000};
+
+    printf("%-8s %-14s %8s %8s %8s %8s   (ns/op)\n", "fds", "table", "add", "modify", "churn", "remove");
+    for (int n : sizes)
+    {
+        std::vector<int> order(n);
+        for (int i = 0; i < n; i++)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(n));
+        std::vector<char> dummy(n);
+
+        Result map = run<MapTable>(n, rounds, order, dummy);
+        Result flat = run<FlatTable>(n, rounds, order, dummy);
+        printf("%-8d %-14s %8.1f %8.1f %8.1f %8.1f\n", n, "unordered_map", map.add, map.modify, map.churn, map.remove);
+        printf("%-8d %-14s %8.1f %8.1f %8.1f %8.1f\n", n, "ChannelMap", flat.add, flat.modify, flat.churn, flat.remove);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 大量空闲连接的内存占用
+// 用法：./idleconns [连接数=100000] [subloop数=0] [每个连接先收发一条消息=1]
+// 需要 ulimit -n 大于两倍连接数（客户端和服务端在同一个进程里）
+
+static long rssKb()
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    long kb = 0;
+    while (fp && fgets(line, sizeof line, fp))
+    {
+        if (strncmp(line, "VmRSS:", 6) == 0)
+        {
+            kb = atol(line + 6);
+        }
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return kb;
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 100000;
+    int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+    bool echoOnce = argc > 3 ? atoi(argv[3]) != 0 : true;
+
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < static_cast<rlim_t>(numConns) * 2 + 64)
+    {
+        fprintf(stderr, "ulimit -n is %lu, need at least %d\n", static_cast<unsigned long>(rl.rlim_cur), numConns * 2 + 64);
+        return 1;
+    }
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    InetAddress addr(9990);
+    TcpServer server(&loop, addr, "IdleConns");
+    std::atomic<int> connected(0);
+    std::atomic<int> echoed(0);
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            ++connected;
+        }
+    });
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+        ++echoed;
+    });
+    server.setThreadNum(numThreads);
+    server.start();
+
+    long baseline = 0;
+    std::vector<int> clients;
+    std::thread client([&]() {
+        baseline = rssKb();
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9990);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+        for (int i = 0; i < numConns; i++)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+            {
+                perror("connect");
+                break;
+            }
+            clients.push_back(fd);
+        }
+        while (connected < static_cast<int>(clients.size()))
+        {
+            usleep(10000);
+        }
+        if (echoOnce)
+        {
+            char buf[64];
+            for (int fd : clients)
+            {
+                ::write(fd, "hello", 5);
+                ::read(fd, buf, sizeof buf);
+            }
+        }
+        sleep(1);
+        long rss = rssKb();
+        printf("connections=%zu echoed=%d rss: before=%ldKB after=%ldKB per connection=%.0f bytes\n",
+               clients.size(), echoed.load(), baseline, rss,
+               clients.empty() ? 0.0 : (rss - baseline) * 1024.0 / clients.size());
+        for (int fd : clients)
+        {
+            ::close(fd);
+        }
+        loop.runAfter(1.0, [&]() { loop.quit(); });
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
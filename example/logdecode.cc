@@ -0,0 +1,28 @@
+#include <mymuduo/binary_logging.h>
+#include <stdio.h>
+
+// 把BinaryLogging kBinary模式写出的日志文件转换成文本
+// 用法：./logdecode server.blog > server.log 不带参数时读标准输入
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    if (argc > 1)
+    {
+        in = fopen(argv[1], "rb");
+        if (in == nullptr)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+    bool ok = BinaryLogging::decode(in, stdout);
+    if (!ok)
+    {
+        fprintf(stderr, "logdecode: bad or truncated binary log\n");
+    }
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <mymuduo/eventloop.h>
+#include <mymuduo/mpsc_queue.h>
+#include <mymuduo/logger.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// 跨线程提交回调的吞吐：1到32个生产者线程
+//   mutex+swap  原来的pendingFunctors_：加锁push_back，消费者加锁swap出来再执行
+//   MpscQueue   每个生产者一个SPSC环形队列，消费者不加锁
+//   queueInLoop 生产者调用EventLoop::queueInLoop，包括唤醒loop的开销
+// 用法：./queuebench [每种配置的回调总数=2000000]
+
+using Functor = EventLoop::Functor;
+
+class MutexQueue
+{
+public:
+    void push(Functor &&cb)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        functors_.push_back(std::move(cb));
+    }
+
+    template <typename Func>
+    size_t drain(Func &&func)
+    {
+        running_.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_.swap(functors_);
+        }
+        for (Functor &cb : running_)
+        {
+            func(cb);
+        }
+        return running_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Functor> functors_;
+    std::vector<Functor> running_;
+};
+
+// 消费者在当前线程一直drain，直到total个回调都执行完，返回每秒百万个
+template <typename Queue>
+static double queueThroughput(Queue &queue, int producers, long total)
+{
+    long perProducer = total / producers;
+    long expected = perProducer * producers;
+    long executed = 0;
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&]() {
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            for (long i = 0; i < perProducer; i++)
+            {
+                queue.push([&executed]() { ++executed; });
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    while (executed < expected)
+    {
+        queue.drain([](Functor &cb) { cb(); });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return expected / seconds / 1e6;
+}
+
+static double loopThroughput(int producers, long total)
+{
+    long perProducer = total / producers;
+    long expected = perProducer * producers;
+    long executed = 0;
+    EventLoop loop;
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&]() {
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            for (long i = 0; i < perProducer; i++)
+            {
+                loop.queueInLoop([&]() {
+                    if (++executed == expected)
+                    {
+                        loop.quit();
+                    }
+                });
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    loop.loop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return expected / seconds / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? atol(argv[1]) : 2000000;
+    Logger::setLogLevel(ERROR);
+
+    printf("%-10s %12s %12s %12s   (Mops/s)\n", "producers", "mutex+swap", "MpscQueue", "queueInLoop");
+    const int producerCounts[] = {1, 2, 4, 8, 16, 32};
+    for (int producers : producerCounts)
+    {
+        MutexQueue mutexQueue;
+        MpscQueue<Functor> mpscQueue;
+        double locked = queueThroughput(mutexQueue, producers, total);
+        double mpsc = queueThroughput(mpscQueue, producers, total);
+        double loop = loopThroughput(producers, total);
+        printf("%-10d %12.2f %12.2f %12.2f\n", producers, locked, mpsc, loop);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 头部+大正文响应的吞吐：64KB到4MB
+//   copy   send(header); send(body)   没写完的部分拷贝进输出缓冲区（原来的做法）
+//   writev send(std::move(header), std::move(body))   一次writev，剩下的整块挂到输出队列上，不拷贝
+// 客户端每次发一个请求：1字节模式 + 4字节正文长度（网络字节序），读完响应再发下一个
+// 用法：./respbench [每种配置的请求数=200]
+
+static const size_t kHeaderSize = 200;
+
+int main(int argc, char *argv[])
+{
+    int iters = argc > 1 ? atoi(argv[1]) : 200;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    InetAddress addr(9987);
+    TcpServer server(&loop, addr, "RespBench");
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([](const TcpConnectionPtr &) {});
+    std::string header(kHeaderSize, 'h');
+    std::string body;
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        while (buf->readableBytes() >= 5)
+        {
+            char mode = buf->readInt8();
+            size_t size = static_cast<size_t>(buf->readInt32());
+            if (body.size() != size)
+            {
+                body.assign(size, 'x');
+            }
+            // 应用每次生成一份响应
+            std::string h(header);
+            std::string b(body);
+            if (mode == 'c')
+            {
+                conn->send(h);
+                conn->send(b);
+            }
+            else
+            {
+                conn->send(std::move(h), std::move(b));
+            }
+        }
+    });
+    server.start();
+
+    std::thread client([&]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in peer;
+        memset(&peer, 0, sizeof peer);
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9987);
+        inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+
+        std::vector<char> readBuf(1 << 20);
+        const size_t sizes[] = {64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+        const char modes[] = {'c', 'w'};
+        printf("%-10s %-8s %10s %12s\n", "body", "mode", "MB/s", "us/response");
+        for (size_t size : sizes)
+        {
+            for (char mode : modes)
+            {
+                char request[5];
+                request[0] = mode;
+                uint32_t be32 = htonl(static_cast<uint32_t>(size));
+                memcpy(request + 1, &be32, sizeof be32);
+                // 第一个请求预热
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i <= iters; i++)
+                {
+                    if (i == 1)
+                    {
+                        start = std::chrono::steady_clock::now();
+                    }
+                    ::write(fd, request, sizeof request);
+                    size_t remaining = kHeaderSize + size;
+                    while (remaining > 0)
+                    {
+                        ssize_t n = ::read(fd, readBuf.data(), std::min(remaining, readBuf.size()));
+                        if (n <= 0)
+                        {
+                            perror("read");
+                            exit(1);
+                        }
+                        remaining -= n;
+                    }
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printf("%-10zu %-8s %10.0f %12.1f\n", size, mode == 'c' ? "copy" : "writev",
+                       iters * (kHeaderSize + size) / seconds / 1e6, seconds * 1e6 / iters);
+            }
+        }
+        ::close(fd);
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
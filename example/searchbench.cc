@@ -0,0 +1,118 @@
+#include <mymuduo/buffer.h>
+#include <mymuduo/byte_search.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buffer查找的微基准：在HTTP请求里找头部结尾"\r\n\r\n"、第一个CRLF和换行，对比std::search和memchr
+// 用法：./searchbench [每种大小的迭代次数=200000]
+
+static std::string makeRequest(size_t size)
+{
+    std::string request = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n";
+    int i = 0;
+    while (request.size() + 4 < size)
+    {
+        char line[64];
+        snprintf(line, sizeof line, "X-Header-%d: value-%08d\r\n", i, i * 7919);
+        request += line;
+        ++i;
+    }
+    request.resize(size - 4, 'x');
+    request += "\r\n\r\n";
+    return request;
+}
+
+// 先用memchr找'\r'再比较后面三个字节，手写协议解析的常见写法
+static const char *memchrSearch(const char *begin, const char *end, const char *seq, size_t len)
+{
+    while (static_cast<size_t>(end - begin) >= len)
+    {
+        const char *p = static_cast<const char *>(memchr(begin, seq[0], end - begin - len + 1));
+        if (p == nullptr)
+        {
+            return nullptr;
+        }
+        if (memcmp(p, seq, len) == 0)
+        {
+            return p;
+        }
+        begin = p + 1;
+    }
+    return nullptr;
+}
+
+template <typename Search>
+static double nsPerOp(int iters, Search search)
+{
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+    {
+        sink += (size_t)search();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (sink == 1)
+    {
+        printf("!");
+    }
+    return ns / iters;
+}
+
+int main(int argc, char *argv[])
+{
+    int iters = argc > 1 ? atoi(argv[1]) : 200000;
+    static const char kHeaderEnd[] = "\r\n\r\n";
+    const size_t sizes[] = {128, 512, 1024, 4096, 16384, 65536};
+
+    printf("%-8s %-10s %10s\n", "size", "method", "ns/op");
+    for (size_t size : sizes)
+    {
+        std::string request = makeRequest(size);
+        Buffer buf;
+        buf.append(request.data(), request.size());
+        const char *begin = buf.peek();
+        const char *end = begin + buf.readableBytes();
+        const int n = static_cast<int>(iters * 512 / (size < 512 ? 512 : size)) + 1;
+
+        printf("%-8zu %-10s %10.1f\n", size, "std::search",
+               nsPerOp(n, [&]() { return std::search(begin, end, kHeaderEnd, kHeaderEnd + 4); }));
+        printf("%-8zu %-10s %10.1f\n", size, "memchr",
+               nsPerOp(n, [&]() { return memchrSearch(begin, end, kHeaderEnd, 4); }));
+        for (int k = ByteSearch::kScalar; k <= ByteSearch::kAvx2; k++)
+        {
+            if (!ByteSearch::setKernel(static_cast<ByteSearch::Kernel>(k)))
+            {
+                continue;
+            }
+            const char *name = ByteSearch::kernelName(static_cast<ByteSearch::Kernel>(k));
+            printf("%-8zu %-10s %10.1f\n", size, name,
+                   nsPerOp(n, [&]() { return buf.findSequence(kHeaderEnd, 4); }));
+        }
+        printf("\n");
+    }
+
+    // 请求分成若干次到达，每次到达都查一遍：从头查和接着上次查
+    const size_t total = 16384;
+    const size_t chunk = 1460;
+    std::string request = makeRequest(total);
+    for (int resume = 0; resume <= 1; resume++)
+    {
+        double ns = nsPerOp(iters / 16 + 1, [&]() {
+            Buffer buf;
+            size_t scanned = 0;
+            const char *found = nullptr;
+            for (size_t pos = 0; pos < total && found == nullptr; pos += chunk)
+            {
+                buf.append(request.data() + pos, std::min(chunk, total - pos));
+                found = resume ? buf.findSequence(kHeaderEnd, 4, &scanned) : buf.findSequence(kHeaderEnd, 4);
+            }
+            return found != nullptr;
+        });
+        printf("%zu bytes in %zu-byte reads, %s: %.1f ns/request\n", total, chunk, resume ? "resumed" : "rescan", ns);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <mymuduo/tcpserver.h>
+#include <mymuduo/logger.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <assert.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 背压下发送的字节顺序：服务端一次send一大块按位置编码的数据，客户端接收缓冲区很小而且读得慢，
+// 发送缓冲区一直是满的，检查收到的每个字节都在它应该在的位置上
+//   就绪通知  IoUringPoller + write
+//   完成式I/O IoUringPoller + 链接的IORING_OP_SEND，一个请求短写不能让后面的请求在流里留下空洞
+// 用法：./sendorder [MB=8]
+
+// 251是质数，64KB的分段错位一定能看出来
+static char patternAt(size_t i)
+{
+    return static_cast<char>(i % 251);
+}
+
+// 返回第一个错位字节的偏移，全部正确返回total
+static size_t receive(uint16_t port, size_t total)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 4096;
+    // 要在connect之前设置，窗口大小在握手时确定
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    sockaddr_in peer;
+    memset(&peer, 0, sizeof peer);
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &peer.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&peer), sizeof peer) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    std::vector<char> buf(4096);
+    size_t got = 0;
+    size_t firstBad = total;
+    while (got < total)
+    {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0)
+        {
+            break;
+        }
+        for (ssize_t i = 0; i < n && firstBad == total; i++)
+        {
+            if (buf[i] != patternAt(got + i))
+            {
+                firstBad = got + i;
+            }
+        }
+        got += n;
+        if (got % (64 * 1024) < static_cast<size_t>(n))
+        {
+            usleep(1000);
+        }
+    }
+    ::close(fd);
+    return got < total && firstBad == total ? got : firstBad;
+}
+
+static size_t runConfig(bool completionIo, size_t total, uint16_t port)
+{
+    EventLoop loop(EventLoop::kIoUringPoller);
+    InetAddress addr(port);
+    TcpServer server(&loop, addr, "SendOrder");
+    std::string data(total, 0);
+    for (size_t i = 0; i < total; i++)
+    {
+        data[i] = patternAt(i);
+    }
+    server.setThreadInitCallback([](EventLoop *) {});
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->send(data);
+        }
+    });
+    server.setCompletionIo(completionIo);
+    server.start();
+
+    size_t result = 0;
+    std::thread client([&]() {
+        result = receive(port, total);
+        loop.runAfter(0.1, [&]() { loop.quit(); });
+    });
+    loop.loop();
+    client.join();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t total = static_cast<size_t>(argc > 1 ? atoi(argv[1]) : 8) << 20;
+    Logger::setLogLevel(ERROR);
+
+    size_t readiness = runConfig(false, total, 9968);
+    printf("readiness      %zu bytes: first bad byte %zu%s\n", total, readiness, readiness == total ? " (none)" : "");
+    size_t completion = runConfig(true, total, 9967);
+    printf("completion I/O %zu bytes: first bad byte %zu%s\n", total, completion, completion == total ? " (none)" : "");
+
+    assert(readiness == total);
+    assert(completion == total);
+    return readiness == total && completion == total ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include "async_logging.h"
+#include "log_file.h"
+#include "timestamp.h"
+#include <chrono>
+#include <string.h>
+#include <stdio.h>
+
+namespace
+{
+    std::atomic<uint64_t> s_nextId{1};
+
+    // 当前线程在哪个AsyncLogging上注册了缓冲区 放在一起，动态库里只查一次TLS
+    struct ThreadLocalBuffer
+    {
+        uint64_t ownerId;
+        void *buffer;
+    };
+    __thread ThreadLocalBuffer t_buffer = {0, nullptr};
+}
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                           off_t rollSize,
+                           int flushIntervalSeconds,
+                           int rollIntervalSeconds,
+                           bool syncOnFlush)
+    : id_(s_nextId++),
+      basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushIntervalSeconds),
+      rollInterval_(rollIntervalSeconds),
+      syncOnFlush_(syncOnFlush),
+      running_(false),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
+      flushRequested_(0),
+      flushDone_(0),
+      droppedBytes_(0)
+{
+    ::pthread_key_create(&threadExitKey_, &AsyncLogging::onThreadExit);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+    ::pthread_key_delete(threadExitKey_);
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::onThreadExit(void *threadBuffer)
+{
+    static_cast<ThreadBuffer *>(threadBuffer)->exited = true;
+}
+
+AsyncLogging::BufferPtr AsyncLogging::newBufferLocked()
+{
+    if (!freeBuffers_.empty())
+    {
+        BufferPtr buffer = std::move(freeBuffers_.back());
+        freeBuffers_.pop_back();
+        return buffer;
+    }
+    return BufferPtr(new LogBuffer);
+}
+
+AsyncLogging::ThreadBuffer *AsyncLogging::threadBuffer()
+{
+    ThreadLocalBuffer &local = t_buffer;
+    if (local.ownerId == id_)
+    {
+        return static_cast<ThreadBuffer *>(local.buffer);
+    }
+
+    // 线程第一次打日志，注册自己的缓冲区
+    std::unique_ptr<ThreadBuffer> threadBuffer(new ThreadBuffer);
+    ThreadBuffer *raw = threadBuffer.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threadBuffer->current = newBufferLocked();
+        threadBuffers_.push_back(std::move(threadBuffer));
+    }
+    ::pthread_setspecific(threadExitKey_, raw);
+    local.ownerId = id_;
+    local.buffer = raw;
+    return raw;
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    if (len > kBufferSize)
+    {
+        len = kBufferSize;
+    }
+
+    ThreadBuffer *threadBuffer = this->threadBuffer();
+    std::lock_guard<std::mutex> lock(threadBuffer->mutex);
+    if (threadBuffer->current->avail() < len)
+    {
+        // 加锁顺序：线程缓冲区 -> mutex_，后台线程不会同时持有两者
+        {
+            std::lock_guard<std::mutex> globalLock(mutex_);
+            fullBuffers_.push_back(std::move(threadBuffer->current));
+            threadBuffer->current = newBufferLocked();
+        }
+        cond_.notify_one();
+    }
+    memcpy(threadBuffer->current->data + threadBuffer->current->len, logline, len);
+    threadBuffer->current->len += len;
+}
+
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    uint64_t target = ++flushRequested_;
+    cond_.notify_one();
+    flushCond_.wait(lock, [&]()
+                    { return flushDone_ >= target || !running_; });
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, rollInterval_, syncOnFlush_);
+    BufferVector buffersToWrite;
+    BufferVector spares; // 和线程缓冲区交换用的空缓冲区
+    std::vector<ThreadBuffer *> threads;
+    std::vector<ThreadBuffer *> exited;
+
+    bool running = true;
+    while (running)
+    {
+        uint64_t flushTarget;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (fullBuffers_.empty() && running_ && flushRequested_ == flushDone_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            buffersToWrite.swap(fullBuffers_);
+            flushTarget = flushRequested_;
+            running = running_;
+            threads.clear();
+            for (const std::unique_ptr<ThreadBuffer> &threadBuffer : threadBuffers_)
+            {
+                threads.push_back(threadBuffer.get());
+            }
+            while (spares.size() < threads.size() && !freeBuffers_.empty())
+            {
+                spares.push_back(std::move(freeBuffers_.back()));
+                freeBuffers_.pop_back();
+            }
+        }
+
+        // 收走各线程还没写满的缓冲区，不持有mutex_，和append的加锁顺序不冲突
+        exited.clear();
+        for (ThreadBuffer *threadBuffer : threads)
+        {
+            bool threadExited = threadBuffer->exited;
+            std::lock_guard<std::mutex> lock(threadBuffer->mutex);
+            if (threadBuffer->current->len > 0)
+            {
+                BufferPtr spare;
+                if (!spares.empty())
+                {
+                    spare = std::move(spares.back());
+                    spares.pop_back();
+                }
+                else
+                {
+                    spare.reset(new LogBuffer);
+                }
+                buffersToWrite.push_back(std::move(threadBuffer->current));
+                threadBuffer->current = std::move(spare);
+            }
+            if (threadExited)
+            {
+                exited.push_back(threadBuffer);
+            }
+        }
+
+        if (buffersToWrite.size() > kMaxPendingBuffers)
+        {
+            uint64_t dropped = 0;
+            for (size_t i = kMaxPendingBuffers; i < buffersToWrite.size(); i++)
+            {
+                dropped += buffersToWrite[i]->len;
+            }
+            droppedBytes_ += dropped;
+            char buf[256];
+            int n = snprintf(buf, sizeof buf, "Dropped log messages at %s, %zu larger buffers, %lu bytes\n",
+                             Timestamp::now().toString().c_str(), buffersToWrite.size() - kMaxPendingBuffers,
+                             static_cast<unsigned long>(dropped));
+            fputs(buf, stderr);
+            output.append(buf, n);
+            buffersToWrite.resize(kMaxPendingBuffers);
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data, buffer->len);
+        }
+        output.flush();
+
+        for (BufferPtr &buffer : buffersToWrite)
+        {
+            buffer->len = 0;
+            if (spares.size() < threads.size())
+            {
+                spares.push_back(std::move(buffer));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (BufferPtr &buffer : buffersToWrite)
+            {
+                if (buffer && freeBuffers_.size() < kMaxFreeBuffers)
+                {
+                    freeBuffers_.push_back(std::move(buffer));
+                }
+            }
+            // 退出的线程不会再append，释放它的缓冲区
+            for (ThreadBuffer *threadBuffer : exited)
+            {
+                for (size_t i = 0; i < threadBuffers_.size(); i++)
+                {
+                    if (threadBuffers_[i].get() == threadBuffer)
+                    {
+                        threadBuffers_[i] = std::move(threadBuffers_.back());
+                        threadBuffers_.pop_back();
+                        break;
+                    }
+                }
+            }
+            flushDone_ = flushTarget;
+        }
+        buffersToWrite.clear();
+        flushCond_.notify_all();
+    }
+}
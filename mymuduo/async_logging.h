@@ -0,0 +1,108 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "thread.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @brief 异步日志后端
+ * 每个打日志的线程有自己的前端缓冲区，append只锁自己的缓冲区（只会和后台线程偶尔竞争），
+ * 写满了交给后台线程，换一块空的继续写
+ * 后台线程在有缓冲区写满或者每隔flushInterval秒时，收集所有线程的缓冲区，批量fwrite到LogFile再flush
+ * 不同线程的日志之间不保证先后顺序
+ *
+ * 用法：
+ *   AsyncLogging asyncLog("/var/log/server", 64 * 1024 * 1024);
+ *   asyncLog.start();
+ *   Logger::instance().setOutput([&](const char *msg, size_t len) { asyncLog.append(msg, len); });
+ *   Logger::instance().setFlush([&]() { asyncLog.flush(); });
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    /**
+     * @param basename 日志文件名前缀 见LogFile
+     * @param rollSize 单个日志文件的最大字节数
+     * @param flushIntervalSeconds 后台线程最长多久写一次文件
+     * @param rollIntervalSeconds 按时间滚动的周期 0表示不按时间滚动
+     * @param syncOnFlush 每次批量写完后fsync
+     */
+    AsyncLogging(const std::string &basename,
+                 off_t rollSize,
+                 int flushIntervalSeconds = 3,
+                 int rollIntervalSeconds = 24 * 3600,
+                 bool syncOnFlush = false);
+    ~AsyncLogging();
+
+    void start();
+    // 写完所有已经提交的日志后退出后台线程
+    void stop();
+
+    // 线程安全
+    void append(const char *logline, size_t len);
+    // 阻塞到调用之前append的日志都写进文件 LOG_FATAL退出前使用
+    void flush();
+
+    // 后台积压太多被丢弃的字节数
+    uint64_t droppedBytes() const { return droppedBytes_.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t kBufferSize = 1024 * 1024;
+    // 积压超过这么多块说明磁盘跟不上，丢掉多余的，防止内存无限增长
+    static const size_t kMaxPendingBuffers = 64;
+    static const size_t kMaxFreeBuffers = 16;
+
+    struct LogBuffer
+    {
+        size_t len = 0;
+        char data[kBufferSize];
+
+        size_t avail() const { return kBufferSize - len; }
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    // 一个前端线程的缓冲区
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        BufferPtr current;
+        std::atomic_bool exited{false}; // 线程已经退出，后台线程收走最后的日志后释放
+    };
+
+    void threadFunc();
+    ThreadBuffer *threadBuffer();
+    // 交出写满的缓冲区，返回一块空的 需要持有mutex_
+    BufferPtr newBufferLocked();
+    static void onThreadExit(void *threadBuffer);
+
+    const uint64_t id_; // 区分AsyncLogging对象，线程局部的缓冲区指针只对自己的owner有效
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int rollInterval_;
+    const bool syncOnFlush_;
+
+    std::atomic_bool running_;
+    Thread thread_;
+    pthread_key_t threadExitKey_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;      // 通知后台线程
+    std::condition_variable flushCond_; // 通知flush的调用者
+    BufferVector fullBuffers_;           // 写满等待后台线程写文件的缓冲区
+    BufferVector freeBuffers_;           // 写完回收的空缓冲区
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers_;
+    uint64_t flushRequested_;
+    uint64_t flushDone_;
+
+    std::atomic<uint64_t> droppedBytes_;
+};
@@ -0,0 +1,678 @@
+#include "binary_logging.h"
+#include "timestamp.h"
+#include <algorithm>
+#include <chrono>
+#include <time.h>
+
+namespace
+{
+    // 调用点注册表 下标是LogSite::id，0保留
+    std::mutex &siteMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+    std::vector<const LogSite *> &siteRegistry()
+    {
+        static std::vector<const LogSite *> sites(1, nullptr);
+        return sites;
+    }
+
+    std::atomic<uint64_t> s_nextId{1};
+
+    // 当前线程在哪个BinaryLogging上注册了环形缓冲区
+    struct ThreadLocalRing
+    {
+        uint64_t ownerId;
+        void *ring;
+    };
+    __thread ThreadLocalRing t_ring = {0, nullptr};
+
+    const char kMagic[8] = {'M', 'U', 'D', 'U', 'O', 'B', 'L', '1'};
+
+    // 二进制流里的条目类型
+    enum EntryKind : uint8_t
+    {
+        kSiteEntry = 1,
+        kMessageEntry = 2,
+        kDroppedEntry = 3,
+    };
+
+    const char *kLevelNames[] = {"[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]"};
+
+    template <typename T>
+    void appendValue(std::string *out, T value)
+    {
+        out->append(reinterpret_cast<const char *>(&value), sizeof value);
+    }
+
+    size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t size = 1;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+}
+
+LogSite::LogSite(int level, const char *format, const char *file, int line)
+    : level(level),
+      format(format),
+      file(file),
+      line(line)
+{
+    std::lock_guard<std::mutex> lock(siteMutex());
+    id = static_cast<uint32_t>(siteRegistry().size());
+    siteRegistry().push_back(this);
+}
+
+BinaryLogging::Ring::Ring(size_t size)
+    : capacity(roundUpPowerOfTwo(size)),
+      mask(capacity - 1),
+      storage(static_cast<char *>(::operator new(capacity))),
+      head(0),
+      cachedHead(0),
+      pendingTail(0),
+      tail(0),
+      dropped(0)
+{
+    // 预先触碰所有页，缺页不落在之后的LOG_*调用上
+    memset(storage, 0, capacity);
+}
+
+BinaryLogging::Ring::~Ring()
+{
+    ::operator delete(storage);
+}
+
+char *BinaryLogging::Ring::reserve(size_t size)
+{
+    size_t current = tail.load(std::memory_order_relaxed);
+    size_t offset = current & mask;
+    // 放不下时尾部剩余的空间整个跳过，记录总是连续的
+    size_t skip = size > capacity - offset ? capacity - offset : 0;
+    if (current + skip + size - cachedHead > capacity)
+    {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (current + skip + size - cachedHead > capacity)
+        {
+            return nullptr;
+        }
+    }
+    if (skip > 0)
+    {
+        // 记录8字节对齐，剩余空间至少能放下siteId
+        uint32_t padding = 0;
+        memcpy(storage + offset, &padding, sizeof padding);
+        current += skip;
+    }
+    pendingTail = current + size;
+    return storage + (current & mask);
+}
+
+BinaryLogging::BinaryLogging(OutputFunc output, Format format, size_t ringSize, int flushIntervalMs)
+    : id_(s_nextId++),
+      output_(std::move(output)),
+      format_(format),
+      ringSize_(ringSize),
+      flushIntervalMs_(flushIntervalMs),
+      running_(false),
+      thread_(std::bind(&BinaryLogging::threadFunc, this), "BinaryLogging"),
+      flushRequested_(0),
+      flushDone_(0),
+      droppedReported_(0)
+{
+    ::pthread_key_create(&threadExitKey_, &BinaryLogging::onThreadExit);
+}
+
+BinaryLogging::~BinaryLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+    ::pthread_key_delete(threadExitKey_);
+}
+
+void BinaryLogging::start()
+{
+    running_ = true;
+    if (format_ == kBinary)
+    {
+        output_(kMagic, sizeof kMagic);
+    }
+    thread_.start();
+}
+
+void BinaryLogging::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void BinaryLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    uint64_t target = ++flushRequested_;
+    cond_.notify_one();
+    flushCond_.wait(lock, [&]()
+                    { return flushDone_ >= target || !running_; });
+}
+
+uint64_t BinaryLogging::droppedMessages() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<Ring> &ring : rings_)
+    {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped + droppedReported_;
+}
+
+int64_t BinaryLogging::now()
+{
+    // 文本日志只精确到秒，粗粒度时钟足够，比CLOCK_REALTIME便宜得多
+    return Timestamp::nowCoarse().microSecondsSinceEpoch();
+}
+
+void BinaryLogging::onThreadExit(void *ring)
+{
+    static_cast<Ring *>(ring)->exited = true;
+}
+
+BinaryLogging::Ring *BinaryLogging::localRing()
+{
+    ThreadLocalRing &local = t_ring;
+    if (local.ownerId == id_)
+    {
+        return static_cast<Ring *>(local.ring);
+    }
+
+    std::unique_ptr<Ring> ring(new Ring(ringSize_));
+    Ring *raw = ring.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(std::move(ring));
+    }
+    ::pthread_setspecific(threadExitKey_, raw);
+    local.ownerId = id_;
+    local.ring = raw;
+    return raw;
+}
+
+void BinaryLogging::threadFunc()
+{
+    std::string out;
+    std::vector<Ring *> rings;
+    std::vector<Ring *> exited;
+
+    bool running = true;
+    while (running)
+    {
+        uint64_t flushTarget;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (running_ && flushRequested_ == flushDone_)
+            {
+                cond_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_));
+            }
+            flushTarget = flushRequested_;
+            running = running_;
+            rings.clear();
+            for (const std::unique_ptr<Ring> &ring : rings_)
+            {
+                rings.push_back(ring.get());
+            }
+        }
+
+        exited.clear();
+        uint64_t dropped = 0;
+        for (Ring *ring : rings)
+        {
+            // 先读exited：线程退出之前写的记录这一轮都能取到
+            bool ringExited = ring->exited;
+            drainRing(ring, &out);
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+            if (ringExited)
+            {
+                exited.push_back(ring);
+            }
+        }
+        if (dropped > 0)
+        {
+            if (format_ == kBinary)
+            {
+                appendValue<uint8_t>(&out, kDroppedEntry);
+                appendValue<uint64_t>(&out, dropped);
+            }
+            else
+            {
+                char buf[64];
+                int n = snprintf(buf, sizeof buf, "Dropped %lu log messages\n", static_cast<unsigned long>(dropped));
+                out.append(buf, n);
+            }
+        }
+        if (!out.empty())
+        {
+            output_(out.data(), out.size());
+            out.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            droppedReported_ += dropped;
+            for (Ring *ring : exited)
+            {
+                for (size_t i = 0; i < rings_.size(); i++)
+                {
+                    if (rings_[i].get() == ring)
+                    {
+                        rings_[i] = std::move(rings_.back());
+                        rings_.pop_back();
+                        break;
+                    }
+                }
+            }
+            flushDone_ = flushTarget;
+        }
+        flushCond_.notify_all();
+    }
+}
+
+void BinaryLogging::drainRing(Ring *ring, std::string *out)
+{
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t tail = ring->tail.load(std::memory_order_acquire);
+    while (head != tail)
+    {
+        const char *p = ring->storage + (head & ring->mask);
+        RecordHeader header;
+        memcpy(&header.siteId, p, sizeof header.siteId);
+        if (header.siteId == 0)
+        {
+            head += ring->capacity - (head & ring->mask);
+            continue;
+        }
+        memcpy(&header, p, sizeof header);
+
+        const char *args = p + sizeof header;
+        size_t argsLen = header.size - sizeof header; // 包括对齐填充，解码时遇到0标记结束
+        if (format_ == kBinary)
+        {
+            appendSite(header.siteId, out);
+            appendValue<uint8_t>(out, kMessageEntry);
+            appendValue<uint32_t>(out, header.siteId);
+            appendValue<int64_t>(out, header.time);
+            appendValue<uint32_t>(out, static_cast<uint32_t>(argsLen));
+            out->append(args, argsLen);
+        }
+        else
+        {
+            const LogSite *site;
+            {
+                std::lock_guard<std::mutex> lock(siteMutex());
+                site = siteRegistry()[header.siteId];
+            }
+            formatRecord(site->level, site->format, header.time, args, argsLen, out);
+        }
+        head += header.size;
+    }
+    ring->head.store(head, std::memory_order_release);
+}
+
+void BinaryLogging::appendSite(uint32_t siteId, std::string *out)
+{
+    if (siteId < sitesWritten_.size() && sitesWritten_[siteId])
+    {
+        return;
+    }
+    const LogSite *site;
+    {
+        std::lock_guard<std::mutex> lock(siteMutex());
+        site = siteRegistry()[siteId];
+    }
+    if (siteId >= sitesWritten_.size())
+    {
+        sitesWritten_.resize(siteId + 1, false);
+    }
+    sitesWritten_[siteId] = true;
+
+    uint16_t formatLen = static_cast<uint16_t>(strlen(site->format));
+    uint16_t fileLen = static_cast<uint16_t>(strlen(site->file));
+    appendValue<uint8_t>(out, kSiteEntry);
+    appendValue<uint32_t>(out, siteId);
+    appendValue<uint8_t>(out, static_cast<uint8_t>(site->level));
+    appendValue<int32_t>(out, site->line);
+    appendValue<uint16_t>(out, formatLen);
+    out->append(site->format, formatLen);
+    appendValue<uint16_t>(out, fileLen);
+    out->append(site->file, fileLen);
+}
+
+void BinaryLogging::formatRecord(int level, const char *format, int64_t time,
+                                 const char *args, size_t len, std::string *out)
+{
+    // 和Logger::log的格式一致：[级别]时间:消息
+    if (level >= 0 && level < static_cast<int>(sizeof kLevelNames / sizeof kLevelNames[0]))
+    {
+        out->append(kLevelNames[level]);
+    }
+    time_t seconds = static_cast<time_t>(time / Timestamp::kMicroSecondsPerSecond);
+    struct tm tm_time;
+    ::localtime_r(&seconds, &tm_time);
+    char buf[64];
+    int n = snprintf(buf, sizeof buf, "%4d/%02d/%02d %02d:%02d:%02d:",
+                     tm_time.tm_year + 1900, tm_time.tm_mon + 1,
+                     tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    out->append(buf, n);
+
+    const char *end = args + len;
+    // 取下一个参数 没有参数或者剩下的字节不够一个参数时返回0，不会读出记录的范围
+    auto nextArg = [&](uint64_t *bits, double *real, const char **str, uint16_t *strLen) -> uint8_t
+    {
+        if (args >= end || *args == 0)
+        {
+            return 0;
+        }
+        uint8_t tag = static_cast<uint8_t>(*args);
+        size_t remaining = static_cast<size_t>(end - args) - 1;
+        size_t need;
+        switch (tag)
+        {
+        case kInt32:
+        case kUInt32:
+            need = sizeof(uint32_t);
+            break;
+        case kInt64:
+        case kUInt64:
+        case kPointer:
+        case kDouble:
+            need = sizeof(uint64_t);
+            break;
+        case kString:
+            need = sizeof *strLen;
+            if (remaining >= need)
+            {
+                memcpy(strLen, args + 1, sizeof *strLen);
+                need += *strLen;
+            }
+            break;
+        default:
+            need = SIZE_MAX;
+            break;
+        }
+        if (need > remaining)
+        {
+            args = end;
+            return 0;
+        }
+        args++;
+
+        switch (tag)
+        {
+        case kInt32:
+        {
+            int32_t v;
+            memcpy(&v, args, sizeof v);
+            *bits = static_cast<uint64_t>(static_cast<int64_t>(v));
+            break;
+        }
+        case kUInt32:
+        {
+            uint32_t v;
+            memcpy(&v, args, sizeof v);
+            *bits = v;
+            break;
+        }
+        case kInt64:
+        case kUInt64:
+        case kPointer:
+            memcpy(bits, args, sizeof *bits);
+            break;
+        case kDouble:
+            memcpy(real, args, sizeof *real);
+            break;
+        case kString:
+            *str = args + sizeof *strLen;
+            break;
+        }
+        args += need;
+        return tag;
+    };
+
+    const char *p = format;
+    while (*p)
+    {
+        if (*p != '%')
+        {
+            const char *next = strchr(p, '%');
+            size_t n = next ? static_cast<size_t>(next - p) : strlen(p);
+            out->append(p, n);
+            p += n;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out->push_back('%');
+            p += 2;
+            continue;
+        }
+
+        // 解析一个转换说明：flags width .precision length conversion，去掉length按实际存储的类型重新拼
+        std::string spec("%");
+        const char *q = p + 1;
+        while (*q && strchr("-+ #0'", *q))
+        {
+            spec.push_back(*q++);
+        }
+        for (int part = 0; part < 2; part++)
+        {
+            if (part == 1)
+            {
+                if (*q != '.')
+                {
+                    break;
+                }
+                spec.push_back(*q++);
+            }
+            if (*q == '*')
+            {
+                uint64_t bits = 0;
+                double real;
+                const char *str;
+                uint16_t strLen;
+                nextArg(&bits, &real, &str, &strLen);
+                spec += std::to_string(static_cast<int>(bits));
+                q++;
+            }
+            while (*q >= '0' && *q <= '9')
+            {
+                spec.push_back(*q++);
+            }
+        }
+        while (*q && strchr("hlLqjzt", *q))
+        {
+            q++;
+        }
+        char conversion = *q;
+        if (conversion == '\0')
+        {
+            break;
+        }
+        p = q + 1;
+
+        uint64_t bits = 0;
+        double real = 0;
+        const char *str = nullptr;
+        uint16_t strLen = 0;
+        uint8_t tag = nextArg(&bits, &real, &str, &strLen);
+        char value[512];
+        int n = -1;
+        if (tag == 0)
+        {
+            out->append("<missing>");
+            continue;
+        }
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+            spec += "lld";
+            spec.back() = conversion;
+            n = snprintf(value, sizeof value, spec.c_str(), static_cast<long long>(bits));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec += "ll";
+            spec.push_back(conversion);
+            n = snprintf(value, sizeof value, spec.c_str(), static_cast<unsigned long long>(bits));
+            break;
+        case 'c':
+            spec.push_back('c');
+            n = snprintf(value, sizeof value, spec.c_str(), static_cast<int>(bits));
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec.push_back(conversion);
+            n = snprintf(value, sizeof value, spec.c_str(), tag == kDouble ? real : static_cast<double>(bits));
+            break;
+        case 's':
+            if (tag == kString)
+            {
+                std::string s(str, strLen);
+                spec.push_back('s');
+                n = snprintf(value, sizeof value, spec.c_str(), s.c_str());
+            }
+            break;
+        case 'p':
+            spec.push_back('p');
+            n = snprintf(value, sizeof value, spec.c_str(), reinterpret_cast<void *>(static_cast<uintptr_t>(bits)));
+            break;
+        default:
+            break;
+        }
+        if (n < 0)
+        {
+            out->append("<bad arg>");
+        }
+        else
+        {
+            out->append(value, std::min(static_cast<size_t>(n), sizeof value - 1));
+        }
+    }
+    if (out->empty() || out->back() != '\n')
+    {
+        out->push_back('\n');
+    }
+}
+
+bool BinaryLogging::decode(FILE *in, FILE *out)
+{
+    char magic[sizeof kMagic];
+    if (fread(magic, 1, sizeof magic, in) != sizeof magic || memcmp(magic, kMagic, sizeof kMagic) != 0)
+    {
+        return false;
+    }
+
+    struct Site
+    {
+        int level;
+        std::string format;
+    };
+    std::vector<Site> sites;
+    std::string line;
+    std::string args;
+    auto readExact = [&](void *data, size_t len)
+    { return fread(data, 1, len, in) == len; };
+
+    uint8_t kind;
+    while (readExact(&kind, sizeof kind))
+    {
+        if (kind == kSiteEntry)
+        {
+            uint32_t id;
+            uint8_t level;
+            int32_t lineNo;
+            uint16_t len;
+            if (!readExact(&id, sizeof id) || !readExact(&level, sizeof level) ||
+                !readExact(&lineNo, sizeof lineNo) || !readExact(&len, sizeof len))
+            {
+                return false;
+            }
+            std::string format(len, '\0');
+            if (!readExact(&format[0], len) || !readExact(&len, sizeof len))
+            {
+                return false;
+            }
+            std::string file(len, '\0');
+            if (!readExact(&file[0], len))
+            {
+                return false;
+            }
+            if (id >= sites.size())
+            {
+                sites.resize(id + 1, Site{-1, std::string()});
+            }
+            sites[id].level = level;
+            sites[id].format = std::move(format);
+        }
+        else if (kind == kMessageEntry)
+        {
+            uint32_t id;
+            int64_t time;
+            uint32_t len;
+            if (!readExact(&id, sizeof id) || !readExact(&time, sizeof time) || !readExact(&len, sizeof len))
+            {
+                return false;
+            }
+            args.resize(len);
+            if (!readExact(&args[0], len))
+            {
+                return false;
+            }
+            line.clear();
+            if (id < sites.size() && sites[id].level >= 0)
+            {
+                formatRecord(sites[id].level, sites[id].format.c_str(), time, args.data(), len, &line);
+            }
+            else
+            {
+                formatRecord(-1, "<unknown log site>", time, args.data(), 0, &line);
+            }
+            fwrite(line.data(), 1, line.size(), out);
+        }
+        else if (kind == kDroppedEntry)
+        {
+            uint64_t dropped;
+            if (!readExact(&dropped, sizeof dropped))
+            {
+                return false;
+            }
+            fprintf(out, "Dropped %lu log messages\n", static_cast<unsigned long>(dropped));
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "thread.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief 日志调用点 LOG_*第一次走二进制日志时构造（函数内static），得到进程内唯一的id
+ * format/file必须是字符串字面量，整个进程生命周期有效
+ */
+struct LogSite
+{
+    LogSite(int level, const char *format, const char *file, int line);
+
+    uint32_t id;
+    int level;
+    const char *format;
+    const char *file;
+    int line;
+};
+
+/**
+ * @brief 二进制延迟格式化日志 Logger的另一种输出
+ * LOG_*调用只把调用点id、时间和参数的原始字节写进本线程的SPSC无锁环形缓冲区，不做任何格式化，
+ * 后台线程定期取走：kBinary模式原样输出二进制流（第一次出现的调用点先输出它的格式串），
+ * 用decode离线转换成文本；kText模式由后台线程格式化成和Logger一样的文本行再输出
+ * 环形缓冲区满了直接丢弃并计数，不阻塞I/O线程
+ * 不同线程的日志之间不保证先后顺序
+ *
+ * 用法：
+ *   BinaryLogging binaryLog([&](const char *data, size_t len) { fwrite(data, 1, len, fp); });
+ *   binaryLog.start();
+ *   Logger::setBinarySink(&binaryLog);
+ *   ...
+ *   Logger::setBinarySink(nullptr);
+ *   binaryLog.stop();
+ */
+class BinaryLogging : noncopyable
+{
+public:
+    using OutputFunc = std::function<void(const char *data, size_t len)>;
+
+    enum Format
+    {
+        kBinary, // 输出二进制流
+        kText,   // 后台线程格式化成文本行
+    };
+
+    static const size_t kDefaultRingSize = 1024 * 1024;
+
+    /**
+     * @param output 后台线程调用，每次一批数据
+     * @param ringSize 每个线程的环形缓冲区字节数，向上取2的幂
+     * @param flushIntervalMs 后台线程多久取一次
+     */
+    explicit BinaryLogging(OutputFunc output,
+                           Format format = kBinary,
+                           size_t ringSize = kDefaultRingSize,
+                           int flushIntervalMs = 10);
+    ~BinaryLogging();
+
+    void start();
+    // 取完所有已经记录的日志后退出后台线程
+    void stop();
+    // 阻塞到调用之前记录的日志都交给了output
+    void flush();
+
+    // 环形缓冲区满丢弃的日志条数
+    uint64_t droppedMessages() const;
+
+    // LOG_*调用 任意线程
+    template <typename... Args>
+    void record(const LogSite &site, const Args &...args);
+
+    /**
+     * @brief 把kBinary模式输出的二进制流转换成文本 离线工具使用
+     * @return false 数据格式不对或者被截断
+     */
+    static bool decode(FILE *in, FILE *out);
+
+private:
+    // 参数类型标记，跟在每个参数的原始字节前面
+    enum ArgTag : uint8_t
+    {
+        kInt32 = 1,
+        kInt64,
+        kUInt32,
+        kUInt64,
+        kDouble,
+        kString,
+        kPointer,
+    };
+
+    // 记录头 siteId为0表示环形缓冲区尾部的填充，跳到开头
+    struct RecordHeader
+    {
+        uint32_t siteId;
+        uint32_t size; // 包括头
+        int64_t time;  // 微秒 CLOCK_REALTIME_COARSE
+    };
+
+    // 单个线程的字节环形缓冲区 记录按8字节对齐，不够放一条记录的尾部用填充跳过
+    struct Ring
+    {
+        explicit Ring(size_t capacity);
+        ~Ring();
+
+        // 生产者：预留size字节，满了返回nullptr
+        char *reserve(size_t size);
+        void commit() { tail.store(pendingTail, std::memory_order_release); }
+
+        const size_t capacity;
+        const size_t mask;
+        char *const storage;
+
+        char pad0[64];
+        std::atomic<size_t> head; // 只由后台线程修改
+        char pad1[64];
+        size_t cachedHead;
+        size_t pendingTail;
+        std::atomic<size_t> tail; // 只由生产者修改
+        std::atomic<uint64_t> dropped;
+        char pad2[64];
+
+        std::atomic_bool exited{false};
+    };
+
+    static size_t align(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+    // 参数编码后的字节数
+    static size_t argsSize() { return 0; }
+    template <typename T, typename... Rest>
+    static size_t argsSize(const T &arg, const Rest &...rest)
+    {
+        return argSize(arg) + argsSize(rest...);
+    }
+    static void encodeArgs(char *) {}
+    template <typename T, typename... Rest>
+    static void encodeArgs(char *p, const T &arg, const Rest &...rest)
+    {
+        p = encodeArg(p, arg);
+        encodeArgs(p, rest...);
+    }
+
+    static char *put(char *p, uint8_t tag, const void *data, size_t len)
+    {
+        *p++ = static_cast<char>(tag);
+        memcpy(p, data, len);
+        return p + len;
+    }
+
+    static size_t stringLength(const char *s)
+    {
+        size_t len = s ? strlen(s) : 6; // "(null)"
+        return len > UINT16_MAX ? UINT16_MAX : len;
+    }
+    static size_t argSize(const char *s) { return 1 + 2 + stringLength(s); }
+    static size_t argSize(char *s) { return argSize(static_cast<const char *>(s)); }
+    static char *encodeArg(char *p, char *s) { return encodeArg(p, static_cast<const char *>(s)); }
+    static char *encodeArg(char *p, const char *s)
+    {
+        uint16_t len = static_cast<uint16_t>(stringLength(s));
+        p = put(p, kString, &len, sizeof len);
+        memcpy(p, s ? s : "(null)", len);
+        return p + len;
+    }
+
+    // 整数按printf的默认提升：不超过4字节的按int/unsigned
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, size_t>::type
+    argSize(const T &)
+    {
+        return 1 + (sizeof(T) <= 4 ? 4 : 8);
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, char *>::type
+    encodeArg(char *p, const T &arg)
+    {
+        bool isSigned = std::is_signed<typename std::conditional<std::is_enum<T>::value, int, T>::type>::value;
+        if (sizeof(T) <= 4)
+        {
+            if (isSigned)
+            {
+                int32_t v = static_cast<int32_t>(arg);
+                return put(p, kInt32, &v, sizeof v);
+            }
+            uint32_t v = static_cast<uint32_t>(arg);
+            return put(p, kUInt32, &v, sizeof v);
+        }
+        if (isSigned)
+        {
+            int64_t v = static_cast<int64_t>(arg);
+            return put(p, kInt64, &v, sizeof v);
+        }
+        uint64_t v = static_cast<uint64_t>(arg);
+        return put(p, kUInt64, &v, sizeof v);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, size_t>::type argSize(const T &)
+    {
+        return 1 + sizeof(double);
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, char *>::type encodeArg(char *p, const T &arg)
+    {
+        double v = static_cast<double>(arg);
+        return put(p, kDouble, &v, sizeof v);
+    }
+
+    template <typename T>
+    static size_t argSize(const T *) { return 1 + sizeof(uint64_t); }
+    template <typename T>
+    static char *encodeArg(char *p, const T *arg)
+    {
+        uint64_t v = reinterpret_cast<uintptr_t>(arg);
+        return put(p, kPointer, &v, sizeof v);
+    }
+
+    Ring *localRing();
+    static void onThreadExit(void *ring);
+    static int64_t now();
+
+    void threadFunc();
+    // 取出一个环形缓冲区里的所有记录追加到out
+    void drainRing(Ring *ring, std::string *out);
+    // kBinary模式下第一次遇到的调用点先写出格式串
+    void appendSite(uint32_t siteId, std::string *out);
+
+    // 把一条记录格式化成文本行
+    static void formatRecord(int level, const char *format, int64_t time,
+                             const char *args, size_t len, std::string *out);
+
+    const uint64_t id_;
+    OutputFunc output_;
+    const Format format_;
+    const size_t ringSize_;
+    const int flushIntervalMs_;
+
+    std::atomic_bool running_;
+    Thread thread_;
+    pthread_key_t threadExitKey_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::condition_variable flushCond_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    uint64_t flushRequested_;
+    uint64_t flushDone_;
+    uint64_t droppedReported_; // 已经写进输出的丢弃条数
+
+    std::vector<bool> sitesWritten_; // 只由后台线程访问
+};
+
+template <typename... Args>
+void BinaryLogging::record(const LogSite &site, const Args &...args)
+{
+    size_t used = sizeof(RecordHeader) + argsSize(args...);
+    size_t size = align(used);
+    Ring *ring = localRing();
+    char *p = ring->reserve(size);
+    if (p == nullptr)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    RecordHeader header = {site.id, static_cast<uint32_t>(size), now()};
+    memcpy(p, &header, sizeof header);
+    encodeArgs(p + sizeof header, args...);
+    // 解码时0表示参数结束，对齐的填充里不能留下环形缓冲区里旧记录的字节
+    memset(p + used, 0, size - used);
+    ring->commit();
+}
@@ -1,43 +1,230 @@
 #include "buffer.h"
+#include "buffer_pool.h"
 #include <sys/uio.h>
+#include <assert.h>
 #include <errno.h>
+#include <string.h>
 #include <unistd.h>
 
+char Buffer::emptyStorage_[Buffer::kCheapPrepend];
+const char Buffer::kCRLF[] = "\r\n";
+
+// 拷贝只带走数据，不共享池
+Buffer::Buffer(const Buffer &rhs)
+    : Buffer(rhs.initialSize_)
+{
+    readHint_ = rhs.readHint_;
+    expected_ = rhs.expected_;
+    append(rhs.peek(), rhs.readableBytes());
+}
+
+Buffer::Buffer(Buffer &&rhs)
+    : Buffer(rhs.initialSize_)
+{
+    readHint_ = rhs.readHint_;
+    expected_ = rhs.expected_;
+    swap(rhs);
+}
+
+const char *Buffer::findSequence(const char *seq, size_t len, size_t *scanned) const
+{
+    size_t readable = readableBytes();
+    const char *found = ByteSearch::findSequence(peek() + (*scanned < readable ? *scanned : readable), beginWrite(), seq, len);
+    if (found)
+    {
+        *scanned = found - peek();
+    }
+    else
+    {
+        *scanned = readable >= len ? readable - len + 1 : 0;
+    }
+    return found;
+}
+
+void Buffer::setPool(BufferPool *pool)
+{
+    if (pooled_)
+    {
+        // 存储属于原来的池，数据搬到新池或者堆上，旧的块随moved析构还回去
+        Buffer moved(initialSize_, pool);
+        moved.append(peek(), readableBytes());
+        swap(moved);
+        return;
+    }
+    pool_ = pool;
+}
+
+void Buffer::prepend(const void *data, size_t len)
+{
+    if (!hasStorage())
+    {
+        // emptyStorage_是所有Buffer共用的，先分配自己的存储
+        reallocate(0);
+    }
+    assert(len <= prependableBytes());
+    readIndex_ -= len;
+    memcpy(begin() + readIndex_, data, len);
+}
+
+void Buffer::makeSpace(size_t len)
+{
+    if (!hasStorage() || writeableBytes() + prependableBytes() < len + kCheapPrepend)
+    {
+        reallocate(len);
+    }
+    else
+    {
+        // move readable data to the front , make space inside buffer
+        size_t readable = readableBytes();
+        std::copy(begin() + readIndex_, begin() + writeIndex_, begin() + kCheapPrepend);
+        readIndex_ = kCheapPrepend;
+        writeIndex_ = readIndex_ + readable;
+    }
+}
+
+void Buffer::reserve(size_t len)
+{
+    // 已经读进来的部分加上len（通常是整条消息）不超过kMaxReadHint时一两次就读完，挪动的量不大，
+    // 不限制readFd的读取量，减少系统调用
+    expected_ = readableBytes() + len > kMaxReadHint ? len : 0;
+    // 限制读取量时后面多留kReadAhead，读到这段数据末尾时顺带读进来的下一条消息也放得下，不用把整段挪到前面
+    size_t want = expected_ > 0 ? len + kReadAhead : len;
+    if (writeableBytes() >= want)
+    {
+        return;
+    }
+    if (hasStorage() && writeableBytes() + prependableBytes() >= want + kCheapPrepend)
+    {
+        makeSpace(want);
+    }
+    else
+    {
+        // 不按两倍取整，按需要的大小分配一次
+        reallocate(want, true);
+    }
+}
+
+void Buffer::reallocate(size_t len, bool exact)
+{
+    size_t readable = readableBytes();
+    size_t needed = kCheapPrepend + readable + len;
+    char *storage;
+    size_t capacity;
+    bool pooled = false;
+    if (pool_ && needed <= pool_->blockSize())
+    {
+        storage = pool_->allocate();
+        capacity = pool_->blockSize();
+        pooled = true;
+    }
+    else
+    {
+        // 按两倍增长，和vector一样均摊O(1)；新存储不初始化
+        capacity = exact ? needed : std::max(needed, hasStorage() ? capacity_ * 2 : kCheapPrepend + initialSize_);
+        storage = new char[capacity];
+    }
+    memcpy(storage + kCheapPrepend, peek(), readable);
+    releaseStorage();
+    buffer_ = storage;
+    capacity_ = capacity;
+    pooled_ = pooled;
+    readIndex_ = kCheapPrepend;
+    writeIndex_ = kCheapPrepend + readable;
+}
+
+void Buffer::releaseStorage()
+{
+    if (!hasStorage())
+    {
+        return;
+    }
+    if (pooled_)
+    {
+        pool_->deallocate(buffer_);
+    }
+    else
+    {
+        delete[] buffer_;
+    }
+    buffer_ = emptyStorage_;
+    capacity_ = kCheapPrepend;
+    pooled_ = false;
+    readIndex_ = writeIndex_ = kCheapPrepend;
+}
+
 /**
- * @brief 从fd上读取数据向buffer里面写（Poller工作LT模式）
+ * @brief 从fd上读取数据向buffer里面写
  *
  * @param fd
  * @param saveErrno
+ * @param extrabuf 溢出缓冲区 可以为nullptr
+ * @param extraLen
  * @return ssize_t
  */
-ssize_t Buffer::readFd(int fd, int *saveErrno)
+ssize_t Buffer::readFd(int fd, int *saveErrno, char *extrabuf, size_t extraLen)
 {
-    char extrabuf[65536]; // 栈上空间 64KB
+    // 最近的读取量比可写空间大，先扩容（或者把数据挪到前面），数据直接落进Buffer
+    // 没有溢出缓冲区时至少留出kInitialSize
+    size_t want = (extraLen > 0 || readHint_ > kInitialSize) ? readHint_ : kInitialSize;
+    // 还没有存储并且最近读得不多，先全部读到溢出缓冲区，读到了数据再分配，空闲连接不占内存
+    if (!hasStorage() && extraLen > 0 && want <= initialSize_)
+    {
+        want = 0;
+    }
+    // reserve过并且放得下预期的数据时不再按预测扩容
+    const bool reserved = expected_ > 0 && writeableBytes() >= expected_;
+    if (!reserved && writeableBytes() < want)
+    {
+        ensureWriteableBytes(want);
+    }
+
     struct iovec vec[2];
-    const size_t writable = writeableBytes(); // 这是Buffer底层缓冲区剩余的可写空间大小
+    size_t writable = writeableBytes(); // 这是Buffer底层缓冲区剩余的可写空间大小
+    if (reserved && writable > expected_ + kReadAhead)
+    {
+        // 只读到预期数据之后kReadAhead为止，读进来的下一条消息少，取走这条消息后要挪到前面的数据也少
+        writable = expected_ + kReadAhead;
+    }
     vec[0].iov_base = begin() + writeIndex_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extraLen;
 
     // when there is enough space in this buffer, don't read into extrabuf
     // readv 可以自动填充iovcnt多个非连续的缓冲区
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1; // 一次读写至少保证64K空间可写
+    const int iovcnt = (extraLen > 0 && writable < extraLen) ? 2 : 1;
+    const size_t capacity = iovcnt == 2 ? writable + extraLen : writable;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if (n < 0)
     {
         *saveErrno = errno;
+        return n;
     }
-    else if (n <= writable)
+
+    const size_t len = static_cast<size_t>(n);
+    expected_ = len < expected_ ? expected_ - len : 0;
+    if (len <= writable)
     {
-        writeIndex_ += n;
+        writeIndex_ += len;
     }
     else // extrabuf里面也写入数据
     {
-        writeIndex_ = buffer_.size();
-        append(extrabuf, n - writable); // writeIndex_开始写n-writeable的数据
+        writeIndex_ += writable;
+        append(extrabuf, len - writable); // writeIndex_开始写n-writeable的数据
     }
 
+    if (len == capacity)
+    {
+        // 全部读满，socket里可能还有数据，下次预留两倍
+        size_t hint = std::max(readHint_, len) * 2;
+        readHint_ = hint < kMaxReadHint ? hint : kMaxReadHint;
+    }
+    else
+    {
+        // 每次回落1/4，偶尔的小包不会马上把预测打下去
+        size_t hint = std::max(len, readHint_ - readHint_ / 4);
+        readHint_ = hint < kMaxReadHint ? hint : kMaxReadHint;
+    }
     return n;
 }
 
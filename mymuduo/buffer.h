@@ -1,7 +1,14 @@
 #pragma once
-#include <vector>
+#include "byte_search.h"
+#include "string_piece.h"
 #include <unistd.h>
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
 #include <string>
+#include <algorithm>
+
+class BufferPool;
 
 /// +-------------------+------------------+------------------+
 /// | prependable bytes |  readable bytes  |  writable bytes  |
@@ -9,18 +16,59 @@
 /// +-------------------+------------------+------------------+
 /// |                   |                  |                  |
 /// 0      <=      readerIndex   <=   writerIndex    <=     size
+///
+/// 构造时不分配存储，第一次写入时才分配：设置了BufferPool时从池里取一块（放得下的话），否则从堆上分配
+/// 池里的块在数据取完时归还，空闲连接的Buffer不占内存
 class Buffer
 {
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    // 预测的单次读取量上限
+    static const size_t kMaxReadHint = 1024 * 1024;
+    // reserve之后readFd最多读过预期数据末尾这么多
+    static const size_t kReadAhead = 64 * 1024;
 
-    explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + initialSize),
+    explicit Buffer(size_t initialSize = kInitialSize, BufferPool *pool = nullptr)
+        : buffer_(emptyStorage_),
+          capacity_(kCheapPrepend),
           readIndex_(kCheapPrepend),
-          writeIndex_(kCheapPrepend)
+          writeIndex_(kCheapPrepend),
+          readHint_(0),
+          expected_(0),
+          initialSize_(initialSize),
+          pool_(pool),
+          pooled_(false)
+    {
+    }
+    Buffer(const Buffer &rhs);
+    Buffer(Buffer &&rhs);
+    Buffer &operator=(Buffer rhs)
     {
+        swap(rhs);
+        return *this;
     }
+    ~Buffer() { releaseStorage(); }
+
+    // 存储和它来自哪个池一起交换，读取量预测、reserve预期的数据量和初始容量属于Buffer本身，不交换
+    void swap(Buffer &rhs)
+    {
+        std::swap(buffer_, rhs.buffer_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(readIndex_, rhs.readIndex_);
+        std::swap(writeIndex_, rhs.writeIndex_);
+        std::swap(pool_, rhs.pool_);
+        std::swap(pooled_, rhs.pooled_);
+    }
+
+    /**
+     * @brief 更换存储池 nullptr表示只用堆 当前存储来自原来的池时把数据搬走、块还回去
+     * 池只能在它的loop线程中使用，Buffer可能在别的线程析构时先setPool(nullptr)
+     */
+    void setPool(BufferPool *pool);
+    BufferPool *pool() const { return pool_; }
+    // 当前存储的总字节数 没有存储时为0
+    size_t capacity() const { return hasStorage() ? capacity_ : 0; }
 
     size_t readableBytes() const
     {
@@ -29,7 +77,7 @@ public:
 
     size_t writeableBytes() const
     {
-        return buffer_.size() - writeIndex_;
+        return capacity_ - writeIndex_;
     }
 
     size_t prependableBytes() const
@@ -43,6 +91,41 @@ public:
         return begin() + readIndex_;
     }
 
+    // 可读数据的视图，不拷贝 retrieve或者append之后失效
+    StringPiece toStringPiece() const
+    {
+        return StringPiece(peek(), readableBytes());
+    }
+
+    /**
+     * @brief 在可读数据中查找，返回找到的位置，找不到返回nullptr
+     * 带start的版本从start开始找，start必须在[peek(), beginWrite()]之间，Buffer变动后失效
+     */
+    const char *findCRLF() const { return findCRLF(peek()); }
+    const char *findCRLF(const char *start) const { return findSequence(start, kCRLF, 2); }
+    const char *findEOL() const { return findEOL(peek()); }
+    const char *findEOL(const char *start) const { return findDelimiter(start, '\n'); }
+    const char *findDelimiter(char delim) const { return findDelimiter(peek(), delim); }
+    const char *findDelimiter(const char *start, char delim) const
+    {
+        return ByteSearch::findByte(start, beginWrite(), delim);
+    }
+    const char *findSequence(const char *seq, size_t len) const { return findSequence(peek(), seq, len); }
+    const char *findSequence(const char *start, const char *seq, size_t len) const
+    {
+        return ByteSearch::findSequence(start, beginWrite(), seq, len);
+    }
+
+    /**
+     * @brief 可以接着上次继续的查找，半个请求到达时不用每次从头扫描
+     * *scanned是相对peek()已经查过的字节数，调用前置0；找到时设为匹配位置的偏移，找不到时设为下次开始的位置
+     * （末尾len-1个字节可能是被截断的匹配，下次重查） retrieve之后要减去取走的字节数或者清零
+     */
+    const char *findCRLF(size_t *scanned) const { return findSequence(kCRLF, 2, scanned); }
+    const char *findEOL(size_t *scanned) const { return findDelimiter('\n', scanned); }
+    const char *findDelimiter(char delim, size_t *scanned) const { return findSequence(&delim, 1, scanned); }
+    const char *findSequence(const char *seq, size_t len, size_t *scanned) const;
+
     // onMessage string <- Buffer
     void retrieve(size_t len)
     {
@@ -56,10 +139,14 @@ public:
         }
     }
 
-    // 复位
+    // 复位 池里的块还回去
     void retrieveAll()
     {
         readIndex_ = writeIndex_ = kCheapPrepend;
+        if (pooled_)
+        {
+            releaseStorage();
+        }
     }
 
     // 把onMessage函数上报的的bbuffer数据转成string类型数据返回
@@ -75,7 +162,7 @@ public:
         return result;
     }
 
-    // buffer_.size() - writeIndex_ len
+    // capacity_ - writeIndex_ len
     void ensureWriteableBytes(size_t len)
     {
         if (writeableBytes() < len)
@@ -84,6 +171,14 @@ public:
         }
     }
 
+    /**
+     * @brief 一次预留至少len字节的可写空间，并告诉readFd接下来预期读进len字节
+     * 知道消息长度的协议先reserve剩下的长度，之后readFd直接读进这块存储，不会边读边翻倍扩容，
+     * 可读数据加上len超过kMaxReadHint时，读到消息末尾最多多读kReadAhead，取走这条消息后要挪到前面的数据很少
+     * 超出池的块大小时从堆上按需要的大小分配（不按两倍取整），存储不初始化
+     */
+    void reserve(size_t len);
+
     // 把data内存上的数据添加到可写缓冲区上
     void append(const char *data, size_t len)
     {
@@ -92,17 +187,126 @@ public:
         writeIndex_ += len;
     }
 
-    // 从fd上读取数据
-    ssize_t readFd(int fd, int *saveErrno);
+    void append(const StringPiece &str)
+    {
+        append(str.data(), str.size());
+    }
+
+    // 把data放到可读数据前面 用kCheapPrepend预留的空间（比如写长度头），len不能超过prependableBytes()
+    void prepend(const void *data, size_t len);
+
+    /**
+     * @brief 网络字节序的整数
+     * append写到末尾，prepend写到可读数据前面，peek只看不取，read读出后取走
+     * peek和read要求可读数据不少于整数的长度
+     */
+    void appendInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        append(reinterpret_cast<const char *>(&be64), sizeof be64);
+    }
+    void appendInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        append(reinterpret_cast<const char *>(&be32), sizeof be32);
+    }
+    void appendInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        append(reinterpret_cast<const char *>(&be16), sizeof be16);
+    }
+    void appendInt8(int8_t x)
+    {
+        append(reinterpret_cast<const char *>(&x), sizeof x);
+    }
+
+    void prependInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        prepend(&be64, sizeof be64);
+    }
+    void prependInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        prepend(&be32, sizeof be32);
+    }
+    void prependInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        prepend(&be16, sizeof be16);
+    }
+    void prependInt8(int8_t x)
+    {
+        prepend(&x, sizeof x);
+    }
+
+    int64_t peekInt64() const
+    {
+        int64_t be64;
+        ::memcpy(&be64, peek(), sizeof be64);
+        return be64toh(be64);
+    }
+    int32_t peekInt32() const
+    {
+        int32_t be32;
+        ::memcpy(&be32, peek(), sizeof be32);
+        return be32toh(be32);
+    }
+    int16_t peekInt16() const
+    {
+        int16_t be16;
+        ::memcpy(&be16, peek(), sizeof be16);
+        return be16toh(be16);
+    }
+    int8_t peekInt8() const
+    {
+        return *peek();
+    }
+
+    int64_t readInt64()
+    {
+        int64_t result = peekInt64();
+        retrieve(sizeof result);
+        return result;
+    }
+    int32_t readInt32()
+    {
+        int32_t result = peekInt32();
+        retrieve(sizeof result);
+        return result;
+    }
+    int16_t readInt16()
+    {
+        int16_t result = peekInt16();
+        retrieve(sizeof result);
+        return result;
+    }
+    int8_t readInt8()
+    {
+        int8_t result = peekInt8();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    /**
+     * @brief 从fd上读取数据
+     * 可写空间不够时超出的部分读到extrabuf再追加进来，extrabuf由调用方提供（EventLoop::extraBuffer）
+     * 根据最近的读取量预留可写空间，大块数据直接读进Buffer，不经过extrabuf多拷贝一次
+     */
+    ssize_t readFd(int fd, int *saveErrno, char *extrabuf, size_t extraLen);
+    // 没有溢出缓冲区，只读到Buffer的可写空间
+    ssize_t readFd(int fd, int *saveErrno) { return readFd(fd, saveErrno, nullptr, 0); }
+    // 预测的下一次读取量
+    size_t readHint() const { return readHint_; }
 
     // 向fd写数据
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
-    // socket编程需要vector底层数组的裸指针
+    // socket编程需要底层数组的裸指针
     char *begin()
     {
-        return &*buffer_.begin();
+        return buffer_;
     }
 
     char *beginWrite()
@@ -112,7 +316,7 @@ private:
 
     const char *begin() const // 仅有返回值不同的函数无法重载
     {
-        return &*buffer_.begin();
+        return buffer_;
     }
 
     const char *beginWrite() const // 仅有返回值不同的函数无法重载
@@ -120,28 +324,32 @@ private:
         return begin() + writeIndex_;
     }
 
+    bool hasStorage() const { return buffer_ != emptyStorage_; }
+
     /*
         kCheapPrepend |  have read | reader | writer |
                                    |
                                 readindex_
     */
-    void makeSpace(size_t len)
-    {
-        if (writeableBytes() + prependableBytes() < len + kCheapPrepend)
-        {
-            buffer_.resize(writeIndex_ + len);
-        }
-        else
-        {
-            // move readable data to the front , make space inside buffer
-            size_t readable = readableBytes();
-            std::copy(begin() + readIndex_, begin() + writeIndex_, begin() + kCheapPrepend);
-            readIndex_ = kCheapPrepend;
-            writeIndex_ = readIndex_ + readable;
-        }
-    }
+    void makeSpace(size_t len);
+    // 换一块至少能放下kCheapPrepend+可读数据+len的存储，可读数据搬到kCheapPrepend处
+    // exact为false时按两倍增长
+    void reallocate(size_t len, bool exact = false);
+    // 释放存储，回到没有存储的状态，可读数据丢弃
+    void releaseStorage();
+
+    static const char kCRLF[];
+
+    // 没有存储时buffer_指向它，只读，容量kCheapPrepend（可写空间为0）
+    static char emptyStorage_[kCheapPrepend];
 
-    std::vector<char> buffer_; // 类对象释放时，vector自动销毁
+    char *buffer_;
+    size_t capacity_;
     size_t readIndex_;
     size_t writeIndex_;
+    size_t readHint_;    // 最近读取量的估计 读满时翻倍，之后逐渐回落
+    size_t expected_;    // reserve预期还要从fd读进来的字节数
+    size_t initialSize_; // 第一次从堆上分配的可写空间
+    BufferPool *pool_;
+    bool pooled_; // buffer_是pool_里的块
 };
\ No newline at end of file
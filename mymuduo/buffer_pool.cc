@@ -0,0 +1,51 @@
+#include "buffer_pool.h"
+#include <algorithm>
+
+// 块至少放得下FreeBlock，再向上取整到16的倍数
+BufferPool::BufferPool(size_t blockSize)
+    : blockSize_((std::max(blockSize, sizeof(FreeBlock)) + 15) & ~static_cast<size_t>(15)),
+      freeList_(nullptr),
+      blocksInUse_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    for (char *slab : slabs_)
+    {
+        delete[] slab;
+    }
+}
+
+char *BufferPool::allocate()
+{
+    if (freeList_ == nullptr)
+    {
+        grow();
+    }
+    FreeBlock *block = freeList_;
+    freeList_ = block->next;
+    ++blocksInUse_;
+    return reinterpret_cast<char *>(block);
+}
+
+void BufferPool::deallocate(char *block)
+{
+    FreeBlock *free = reinterpret_cast<FreeBlock *>(block);
+    free->next = freeList_;
+    freeList_ = free;
+    --blocksInUse_;
+}
+
+void BufferPool::grow()
+{
+    char *slab = new char[kBlocksPerSlab * blockSize_];
+    slabs_.push_back(slab);
+    // 倒序挂上去，先分配出去的是低地址
+    for (size_t i = kBlocksPerSlab; i > 0; i--)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(slab + (i - 1) * blockSize_);
+        block->next = freeList_;
+        freeList_ = block;
+    }
+}
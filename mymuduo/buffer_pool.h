@@ -0,0 +1,44 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <vector>
+#include <stddef.h>
+
+/**
+ * @brief Buffer存储块的池 每个EventLoop一个，只能在loop线程中使用
+ * 块的大小固定（Buffer初始容量），一次向系统申请kBlocksPerSlab块，归还的块挂在空闲链表上复用
+ * 空闲连接的Buffer不持有存储，有数据时才从池里取一块，数据取完就还回来
+ * 块不初始化，不像std::vector<char>那样先清零
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kBlocksPerSlab = 64;
+
+    explicit BufferPool(size_t blockSize);
+    ~BufferPool();
+
+    size_t blockSize() const { return blockSize_; }
+
+    char *allocate();
+    void deallocate(char *block);
+
+    // 借出去还没有归还的块数
+    size_t blocksInUse() const { return blocksInUse_; }
+    // 向系统申请的总字节数
+    size_t bytesReserved() const { return slabs_.size() * kBlocksPerSlab * blockSize_; }
+
+private:
+    // 空闲块的前8个字节存下一个空闲块
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    void grow();
+
+    const size_t blockSize_;
+    std::vector<char *> slabs_;
+    FreeBlock *freeList_;
+    size_t blocksInUse_;
+};
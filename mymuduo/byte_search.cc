@@ -0,0 +1,216 @@
+#include "byte_search.h"
+#include <atomic>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MYMUDUO_BYTE_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ByteSearch
+{
+    namespace
+    {
+        struct Kernels
+        {
+            Kernel kernel;
+            const char *(*findByte)(const char *, const char *, char);
+            const char *(*findSequence)(const char *, const char *, const char *, size_t);
+        };
+
+        const char *scalarFindByte(const char *begin, const char *end, char c)
+        {
+            return static_cast<const char *>(::memchr(begin, c, end - begin));
+        }
+
+        // 候选位置是[begin, end - len]，调用方保证len >= 2
+        const char *scalarFindSequence(const char *begin, const char *end, const char *seq, size_t len)
+        {
+            const char *stop = end - len + 1;
+            while (begin < stop)
+            {
+                begin = static_cast<const char *>(::memchr(begin, seq[0], stop - begin));
+                if (begin == nullptr)
+                {
+                    return nullptr;
+                }
+                if (::memcmp(begin + 1, seq + 1, len - 1) == 0)
+                {
+                    return begin;
+                }
+                ++begin;
+            }
+            return nullptr;
+        }
+
+#ifdef MYMUDUO_BYTE_SEARCH_X86
+        const char *sse2FindByte(const char *begin, const char *end, char c)
+        {
+            const __m128i needle = _mm_set1_epi8(c);
+            for (; begin + 16 <= end; begin += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+                if (mask != 0)
+                {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return scalarFindByte(begin, end, c);
+        }
+
+        // 一次检查16个候选位置：位置i上是首字节并且i+len-1上是尾字节，len <= 2时候选就是结果
+        const char *sse2FindSequence(const char *begin, const char *end, const char *seq, size_t len)
+        {
+            const __m128i first = _mm_set1_epi8(seq[0]);
+            const __m128i last = _mm_set1_epi8(seq[len - 1]);
+            const char *stop = end - len + 1;
+            for (; begin + 16 <= stop; begin += 16)
+            {
+                __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + len - 1));
+                unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+                while (mask != 0)
+                {
+                    const char *candidate = begin + __builtin_ctz(mask);
+                    if (len <= 2 || ::memcmp(candidate + 1, seq + 1, len - 2) == 0)
+                    {
+                        return candidate;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return scalarFindSequence(begin, end, seq, len);
+        }
+
+        __attribute__((target("avx2"))) const char *avx2FindByte(const char *begin, const char *end, char c)
+        {
+            const __m256i needle = _mm256_set1_epi8(c);
+            for (; begin + 32 <= end; begin += 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+                if (mask != 0)
+                {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return sse2FindByte(begin, end, c);
+        }
+
+        __attribute__((target("avx2"))) const char *avx2FindSequence(const char *begin, const char *end, const char *seq, size_t len)
+        {
+            const __m256i first = _mm256_set1_epi8(seq[0]);
+            const __m256i last = _mm256_set1_epi8(seq[len - 1]);
+            const char *stop = end - len + 1;
+            for (; begin + 32 <= stop; begin += 32)
+            {
+                __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + len - 1));
+                unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+                while (mask != 0)
+                {
+                    const char *candidate = begin + __builtin_ctz(mask);
+                    if (len <= 2 || ::memcmp(candidate + 1, seq + 1, len - 2) == 0)
+                    {
+                        return candidate;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return sse2FindSequence(begin, end, seq, len);
+        }
+#endif
+
+        const Kernels kKernels[] = {
+            {kScalar, scalarFindByte, scalarFindSequence},
+#ifdef MYMUDUO_BYTE_SEARCH_X86
+            {kSse2, sse2FindByte, sse2FindSequence},
+            {kAvx2, avx2FindByte, avx2FindSequence},
+#endif
+        };
+
+        bool supported(Kernel kernel)
+        {
+#ifdef MYMUDUO_BYTE_SEARCH_X86
+            if (kernel == kAvx2)
+            {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+            }
+            return true; // x86-64的基线包含SSE2
+#else
+            return kernel == kScalar;
+#endif
+        }
+
+        // 常量初始化为nullptr，别的翻译单元的静态初始化里调用也能正确选择
+        std::atomic<const Kernels *> g_active(nullptr);
+
+        const Kernels *active()
+        {
+            const Kernels *kernels = g_active.load(std::memory_order_relaxed);
+            if (__builtin_expect(kernels == nullptr, 0))
+            {
+                Kernel best = supported(kAvx2) ? kAvx2 : (supported(kSse2) ? kSse2 : kScalar);
+                kernels = &kKernels[best];
+                g_active.store(kernels, std::memory_order_relaxed);
+            }
+            return kernels;
+        }
+    }
+
+    Kernel kernel()
+    {
+        return active()->kernel;
+    }
+
+    bool setKernel(Kernel kernel)
+    {
+        if (!supported(kernel))
+        {
+            return false;
+        }
+        g_active.store(&kKernels[kernel], std::memory_order_relaxed);
+        return true;
+    }
+
+    const char *kernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case kSse2:
+            return "sse2";
+        case kAvx2:
+            return "avx2";
+        default:
+            return "scalar";
+        }
+    }
+
+    const char *findByte(const char *begin, const char *end, char c)
+    {
+        if (begin >= end)
+        {
+            return nullptr;
+        }
+        return active()->findByte(begin, end, c);
+    }
+
+    const char *findSequence(const char *begin, const char *end, const char *seq, size_t len)
+    {
+        if (len == 0)
+        {
+            return begin;
+        }
+        if (len == 1)
+        {
+            return findByte(begin, end, seq[0]);
+        }
+        if (end - begin < static_cast<ptrdiff_t>(len))
+        {
+            return nullptr;
+        }
+        return active()->findSequence(begin, end, seq, len);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief 在一段内存里查找字节或者字节序列，Buffer::findCRLF等用的内核
+ * x86-64上有SSE2和AVX2两套实现，第一次调用时按CPU支持的指令集选一套，其它平台用memchr+memcmp的标量实现
+ * 序列查找先用SIMD同时比较首字节和尾字节筛出候选位置，再用memcmp确认中间部分
+ */
+namespace ByteSearch
+{
+    enum Kernel
+    {
+        kScalar,
+        kSse2,
+        kAvx2,
+    };
+
+    // 当前使用的实现
+    Kernel kernel();
+    // 切换实现，CPU不支持时返回false 用于对比测试
+    bool setKernel(Kernel kernel);
+    const char *kernelName(Kernel kernel);
+
+    // [begin, end)中第一个c，找不到返回nullptr
+    const char *findByte(const char *begin, const char *end, char c);
+    // [begin, end)中第一次出现seq的位置，找不到返回nullptr len为0时返回begin
+    const char *findSequence(const char *begin, const char *end, const char *seq, size_t len);
+}
@@ -13,6 +13,7 @@ Channel::Channel(EventLoop *loop, int fd)
       events_(0),
       revents_(0),
       index_(-1),
+      edgeTriggered_(false),
       tied_(false)
 {
 }
@@ -54,7 +55,7 @@ void Channel::handleEvent(Timestamp receiveTime)
 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("Channel::handleEventWithGuard:%d\n", revents_);
+    LOG_DEBUG("Channel::handleEventWithGuard:%d\n", revents_);
 
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
     {
@@ -3,6 +3,7 @@
 #include "noncopyable.h"
 #include <functional>
 #include "timestamp.h"
+#include "inplace_function.h"
 #include <memory>
 
 class EventLoop;
@@ -15,8 +16,10 @@ class EventLoop;
 class Channel : noncopyable
 {
 public:
-    using EventCallback = std::function<void()>; // 替代typedef
-    using ReadEventCallback = std::function<void(Timestamp)>;
+    static const size_t kCallbackCapacity = 32;
+    // 回调一般是 bind(&X::handleXxx, this)，32字节足够，比std::function省去堆分配
+    using EventCallback = InplaceFunction<void(), kCallbackCapacity>; // 替代typedef
+    using ReadEventCallback = InplaceFunction<void(Timestamp), kCallbackCapacity>;
 
     Channel(EventLoop *loop, int fd);
     ~Channel();
@@ -43,6 +46,14 @@ public:
     // 供Poller调用
     void set_revents(int revt) { revents_ = revt; }
 
+    /**
+     * @brief 边沿触发 Poller注册时带上EPOLLET，写事件可以一直注册着而不用反复epoll_ctl
+     * 回调必须读写到EAGAIN（或者自己安排下一次继续），否则不会再收到通知
+     * 需要在enableReading/enableWriting之前设置
+     */
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
     // 设置fd的相应的事件和状态 设置fd对哪些事件感兴趣
     void enableReading()
     {
@@ -108,6 +119,7 @@ private:
     int events_;      // 注册fd感兴趣的事件
     int revents_;     // poller返回具体发生的事件
     int index_;       // channel的状态（是否添加到Poller） epoll_ctl是会先判断状态
+    bool edgeTriggered_;
 
     // 这里使用弱指针，是为了避免与TcpConnection循环引用：
     /**  _________________        ____________
@@ -1,15 +1,35 @@
 #include "poller.h"
 #include "epoll_poller.h"
+#include "io_uring_poller.h"
+#include "eventloop.h"
+#include "logger.h"
+
+#include <stdlib.h>
 
 //单独一个.cc文件实现，因为基类包含派生类头文件是不好的实现
 Poller *Poller::newDefaultPoller(EventLoop *loop)
 {
-    if (::getenv("MUDUO_USE_POLL"))
+    EventLoop::PollerType type = loop->pollerType();
+    if (type == EventLoop::kDefaultPoller && ::getenv("MUDUO_USE_IOURING"))
+    {
+        type = EventLoop::kIoUringPoller;
+    }
+
+    if (type == EventLoop::kIoUringPoller)
     {
-        return nullptr; //生成Poll实例对象
+        IoUringPoller *poller = new IoUringPoller(loop);
+        if (poller->valid())
+        {
+            return poller;
+        }
+        // 内核不支持io_uring或者被禁用，退回epoll
+        LOG_ERROR("%s io_uring unavailable, fall back to epoll\n", __FUNCTION__);
+        delete poller;
     }
-    else
+    else if (type == EventLoop::kDefaultPoller && ::getenv("MUDUO_USE_POLL"))
     {
-        return new EpollPoller(loop); //生成EPoll实例对象
+        // 没有poll(2)的实现，EventLoop不能拿到空的poller
+        LOG_ERROR("%s MUDUO_USE_POLL is not supported, use epoll\n", __FUNCTION__);
     }
+    return new EpollPoller(loop); //生成EPoll实例对象
 }
@@ -5,6 +5,7 @@
 #include <string.h>
 #include "logger.h"
 #include <unistd.h>
+#include <algorithm>
 
 // channel未添加到poller中
 const int kNew = -1; // channel的成员index_=-1
@@ -17,7 +18,12 @@ const int kDeleted = 2;
 EpollPoller::EpollPoller(EventLoop *loop)
     : Poller(loop),
       epollfd_(::epoll_create(EPOLL_CLOEXEC)),
-      events_(kInitEventListSize)
+      events_(kInitEventListSize),
+      minEvents_(kInitEventListSize),
+      maxEvents_(kMaxEventListSize),
+      peakEvents_(0),
+      windowPolls_(0),
+      pollSeq_(0)
 {
     if (epollfd_ < 0)
     {
@@ -39,21 +45,41 @@ EpollPoller::~EpollPoller()
  */
 Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    LOG_DEBUG("EpollPoller::poll  channels_.size %d\n", channels_.size());
+    LOG_DEBUG("EpollPoller::poll  channels_.size %zu\n", channels_.size());
 
+    applyUpdates();
+
+    int limit = static_cast<int>(events_.size());
     int numEvents = ::epoll_wait(epollfd_,
                                  &*events_.begin(), // 使用vector兼容数组
-                                 static_cast<int>(events_.size()),
+                                 limit,
                                  timeoutMs);
     int savedErrno = errno;
     Timestamp now(Timestamp::now());
+    size_t firstNew = activeChannels->size();
+    size_t total = 0; // 内核返回的事件数，包括再取时重复报告的
     if (numEvents > 0)
     {
         LOG_DEBUG("%s numEvents %d\n", __FUNCTION__, numEvents);
+        ++pollSeq_;
         fillActiveChannels(numEvents, activeChannels);
-        if (numEvents == events_.size()) // 发生时间数可能大于vector.size()，扩容
+        total = numEvents;
+        // 数组填满了，内核里可能还有就绪事件：扩容后不阻塞地再取，一轮处理完突发，总数不超过maxEvents_
+        while (numEvents == limit && total < maxEvents_)
         {
-            events_.resize(events_.size() * 2);
+            if (events_.size() < maxEvents_)
+            {
+                events_.resize(std::min(events_.size() * 2, maxEvents_));
+            }
+            limit = static_cast<int>(std::min(events_.size(), maxEvents_ - total));
+            numEvents = ::epoll_wait(epollfd_, &*events_.begin(), limit, 0);
+            ++pollStats_.drains;
+            if (numEvents <= 0)
+            {
+                break;
+            }
+            fillActiveChannels(numEvents, activeChannels);
+            total += numEvents;
         }
     }
     else if (numEvents == 0)
@@ -68,14 +94,56 @@ Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
             LOG_ERROR("%s failed!\n", __FUNCTION__);
         }
     }
+    shrinkEventList(total);
+    recordPoll(activeChannels->size() - firstNew);
+    pollStats_.eventListSize = events_.size();
     return now;
 }
 
+void EpollPoller::shrinkEventList(size_t numEvents)
+{
+    peakEvents_ = std::max(peakEvents_, numEvents);
+    if (++windowPolls_ < kShrinkWindow)
+    {
+        return;
+    }
+    // 整个窗口内峰值都不到1/4，缩小一半，真正释放内存
+    if (peakEvents_ * 4 < events_.size() && events_.size() > minEvents_)
+    {
+        EventList(std::max(events_.size() / 2, minEvents_)).swap(events_);
+    }
+    peakEvents_ = 0;
+    windowPolls_ = 0;
+}
+
+void EpollPoller::setEventListLimits(size_t minEvents, size_t maxEvents)
+{
+    minEvents_ = std::max<size_t>(minEvents, 1);
+    maxEvents_ = std::max(maxEvents, minEvents_);
+    size_t size = std::min(std::max(events_.size(), minEvents_), maxEvents_);
+    if (size != events_.size())
+    {
+        EventList(size).swap(events_);
+    }
+    pollStats_.eventListSize = events_.size();
+}
+
+EpollPoller::FdState &EpollPoller::fdState(int fd)
+{
+    if (static_cast<size_t>(fd) >= fdStates_.size())
+    {
+        FdState init = {0, false, false, 0};
+        fdStates_.resize(fd + 1, init);
+    }
+    return fdStates_[fd];
+}
+
 // 更新Channel channel update remove => Eventloop =>Poller
+// 只更新channel的状态并把fd记为dirty，epoll_ctl推迟到下一次poll
 void EpollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index(); // channel的状态（是否添加到Poller）
-    LOG_INFO("%s => fd=%d events=%d index=%d\n", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_DEBUG("%s => fd=%d events=%d index=%d\n", __FUNCTION__, channel->fd(), channel->events(), index);
 
     // 新的channel先放到ChannelMap中，再注册到Poller
     // 已经从Poller中删除的channel，虽然还在Map中，但需要重新注册到Poller
@@ -84,23 +152,20 @@ void EpollPoller::updateChannel(Channel *channel)
         if (index == kNew)
         {
             int fd = channel->fd();
-            channels_[fd] = channel;
+            channels_.insert(fd, channel);
         }
         channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
     }
-    else // channel已经在poller上注册过了
+    else if (channel->isNoneEvent()) // channel已经在Map里面，但是对任何事件都不感兴趣
     {
-        int fd = channel->fd();
-        if (channel->isNoneEvent()) // channel已经在Map里面，但是对任何事件都不感兴趣
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_MOD, channel);
-        }
+        channel->set_index(kDeleted);
+    }
+
+    FdState &state = fdState(channel->fd());
+    if (!state.dirty)
+    {
+        state.dirty = true;
+        dirtyFds_.push_back(channel->fd());
     }
 }
 
@@ -108,34 +173,82 @@ void EpollPoller::updateChannel(Channel *channel)
 void EpollPoller::removeChannel(Channel *channel)
 {
     int fd = channel->fd();
-    int index = channel->index();
     channels_.erase(fd);
-    if (index == kAdded)
+    // channel马上就要析构，fd也会被关闭，不能等到下一次poll再从内核删除
+    FdState &state = fdState(fd);
+    if (state.registered)
     {
-        update(EPOLL_CTL_DEL, channel);
+        update(EPOLL_CTL_DEL, fd, 0, channel);
+        state.registered = false;
     }
+    state.dirty = false; // 留在dirtyFds_里的fd提交时跳过
     channel->set_index(kNew);
 }
 
+void EpollPoller::applyUpdates()
+{
+    for (int fd : dirtyFds_)
+    {
+        FdState &state = fdStates_[fd];
+        if (!state.dirty)
+        {
+            continue;
+        }
+        state.dirty = false;
+
+        Channel *channel = channels_.find(fd);
+        bool wanted = channel != nullptr && channel->index() == kAdded && !channel->isNoneEvent();
+        if (!wanted)
+        {
+            if (state.registered)
+            {
+                update(EPOLL_CTL_DEL, fd, 0, channel);
+                state.registered = false;
+            }
+            continue;
+        }
+
+        uint32_t events = channel->events() | (channel->edgeTriggered() ? static_cast<uint32_t>(EPOLLET) : 0u);
+        if (!state.registered)
+        {
+            update(EPOLL_CTL_ADD, fd, events, channel);
+            state.registered = true;
+            state.events = events;
+        }
+        else if (events != state.events)
+        {
+            update(EPOLL_CTL_MOD, fd, events, channel);
+            state.events = events;
+        }
+    }
+    dirtyFds_.clear();
+}
+
 // 填写活跃的连接
-void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
+void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
 {
     for (int i = 0; i < numEvents; i++)
     {
         Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
+        // 水平触发的fd在同一轮再取时会被重复报告，只分发一次
+        FdState &state = fdStates_[channel->fd()];
+        if (state.pollSeq == pollSeq_)
+        {
+            continue;
+        }
+        state.pollSeq = pollSeq_;
         channel->set_revents(events_[i].events);
         activeChannels->push_back(channel); // EveneLoop就拿到了它的poller给它返回的所有发生事件的channel列表
     }
 }
 
 // 更新channel通道
-void EpollPoller::update(int operation, Channel *channel)
+void EpollPoller::update(int operation, int fd, uint32_t events, Channel *channel)
 {
     struct epoll_event event;
     memset(&event, 0, sizeof(event));
-    event.events = channel->events();
+    event.events = events;
     event.data.ptr = channel;
-    int fd = channel->fd();
 
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
@@ -1,9 +1,17 @@
 #pragma once
 #include "poller.h"
 #include <vector>
+#include <stdint.h>
 
 class Channel;
 
+/**
+ * @brief 基于epoll的Poller
+ * updateChannel只记录发生变化的fd，poll在epoll_wait之前统一提交，
+ * 一轮循环里多次enable/disable同一个channel只产生一次epoll_ctl，净变化为零时不产生
+ * 事件数组在[minEvents, maxEvents]之间伸缩：填满时扩容并用timeout=0再取一次，
+ * 连续一段时间用不到1/4时缩小一半
+ */
 class EpollPoller : public Poller
 {
 public:
@@ -17,16 +25,44 @@ public:
     void updateChannel(Channel *channel) override;
     void removeChannel(Channel *channel) override;
 
+    void setEventListLimits(size_t minEvents, size_t maxEvents) override;
+
 private:
     static const int kInitEventListSize = 16;
+    static const int kMaxEventListSize = 4096;
+    // 缩容的观察窗口（poll次数）
+    static const int kShrinkWindow = 256;
 
     // 填写活跃的连接
-    void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
+    void fillActiveChannels(int numEvents, ChannelList *activeChannels);
+    // 根据最近的利用率缩小事件数组
+    void shrinkEventList(size_t numEvents);
+    // 把dirtyFds_的净变化提交给内核
+    void applyUpdates();
     // 更新channel通道
-    void update(int operation, Channel *channel);
+    void update(int operation, int fd, uint32_t events, Channel *channel);
+
+    // 按fd索引：内核里实际注册的事件
+    struct FdState
+    {
+        uint32_t events;  // 注册的事件，包括EPOLLET
+        bool registered;  // 已经EPOLL_CTL_ADD
+        bool dirty;       // 在dirtyFds_中等待提交
+        uint32_t pollSeq; // 最近一次被放进activeChannels的poll序号，用于去重
+    };
+    FdState &fdState(int fd);
 
     // 参照epoll编程：epoll_create epoll_ctl epoll_wait
     using EventList = std::vector<struct epoll_event>;
     int epollfd_;
     EventList events_;
+    size_t minEvents_;
+    size_t maxEvents_;
+    size_t peakEvents_; // 本窗口内单次poll的最多事件数
+    int windowPolls_;
+    uint32_t pollSeq_;
+
+    std::vector<FdState> fdStates_;
+    // 本轮循环中兴趣事件变化过的fd
+    std::vector<int> dirtyFds_;
 };
\ No newline at end of file
@@ -3,9 +3,14 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include "poller.h"
+#include "io_uring_poller.h"
 #include "logger.h"
 #include "channel.h"
+#include "timer_queue.h"
+#include "timing_wheel.h"
+#include "buffer.h"
 #include <memory>
+#include <algorithm>
 
 // 防止一个线程创建多个EventLoop
 __thread EventLoop *t_loopInThisThread = nullptr;
@@ -13,6 +18,12 @@ __thread EventLoop *t_loopInThisThread = nullptr;
 // 定义默认的polller IO的服用接口超时时间
 const int kPollTimeMs = 10000;
 
+// urgent回调很少，每个生产者的环形队列小一些
+const size_t kUrgentRingCapacity = 64;
+
+// 有时间预算时，每执行这么多回调检查一次时间
+const size_t kBudgetCheckInterval = 16;
+
 // 创建wakeupfd，用来notify唤醒subReactor处理新来的channnel
 int createEventfd()
 {
@@ -26,14 +37,29 @@ int createEventfd()
     return evtfd;
 }
 
-EventLoop::EventLoop()
+EventLoop::EventLoop(PollerType pollerType)
     : looping_(false),
       quit_(false),
       callingPendingFunctors_(false),
       threadId_(CurrentThread::tid()),
+      monotonicNow_(Timestamp::monotonic()),
+      busyPollMaxUs_(0),
+      spinBudgetUs_(0),
+      idleGapUs_(0),
+      pollerType_(pollerType),
       poller_(Poller::newDefaultPoller(this)),
+      ioUringPoller_(dynamic_cast<IoUringPoller *>(poller_.get())),
       wakeupFd_(createEventfd()),
-      wakeupChannel_(new Channel(this, wakeupFd_))
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      wakeupPending_(false),
+      wakeupWrites_(0),
+      timerQueue_(new TimerQueue(this)),
+      runningIndex_(0),
+      urgentFunctors_(kUrgentRingCapacity),
+      functorBudget_(0),
+      functorBudgetUs_(0),
+      extraBuffer_(kDefaultExtraBufferSize),
+      bufferPool_(Buffer::kCheapPrepend + Buffer::kInitialSize)
 {
     LOG_DEBUG("EventLopp created %p in thread %d\n", this, threadId_);
     if (t_loopInThisThread)
@@ -73,7 +99,20 @@ void EventLoop::loop()
     {
         activeChannels_.clear();
         // 监听两类fd 一种是client的fd 一种是wakeupfd
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        if (hasPendingFunctors())
+        {
+            // 上一轮预算用完留下的回调，不阻塞，处理完I/O继续执行
+            pollReturnTime_ = poller_->poll(0, &activeChannels_);
+        }
+        else if (busyPollMaxUs_ > 0)
+        {
+            pollReturnTime_ = busyPoll();
+        }
+        else
+        {
+            pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        }
+        monotonicNow_ = Timestamp::monotonic();
 
         for (Channel *channel : activeChannels_)
         {
@@ -88,6 +127,51 @@ void EventLoop::loop()
 
     LOG_INFO("EventLoop %p stop looping\n", this);
 }
+Timestamp EventLoop::busyPoll()
+{
+    int64_t start = Timestamp::now().microSecondsSinceEpoch();
+    Timestamp now;
+    if (spinBudgetUs_ > 0)
+    {
+        do
+        {
+            now = poller_->poll(0, &activeChannels_);
+            if (!activeChannels_.empty() || hasPendingFunctors())
+            {
+                updateSpinBudget(now.microSecondsSinceEpoch() - start);
+                return now;
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } while (now.microSecondsSinceEpoch() - start < spinBudgetUs_);
+    }
+
+    // 自旋预算用完还没有事件，阻塞等待
+    now = poller_->poll(kPollTimeMs, &activeChannels_);
+    if (!activeChannels_.empty())
+    {
+        updateSpinBudget(now.microSecondsSinceEpoch() - start);
+    }
+    return now;
+}
+
+void EventLoop::updateSpinBudget(int64_t idleUs)
+{
+    // 滑动平均 new = 7/8 old + 1/8 sample
+    idleGapUs_ = (idleGapUs_ * 7 + idleUs) / 8;
+    // 事件间隔在最大自旋时间内时，自旋两倍平均间隔基本能等到下一个事件
+    // 间隔太长说明负载低，自旋只会浪费CPU
+    if (idleGapUs_ <= busyPollMaxUs_)
+    {
+        spinBudgetUs_ = std::min<int64_t>(busyPollMaxUs_, std::max<int64_t>(idleGapUs_ * 2, 1));
+    }
+    else
+    {
+        spinBudgetUs_ = 0;
+    }
+}
+
 /**
  * @brief 退出事件循环 1.loop在自己线程中调用quit 此时自己肯定不在epoll_wait
  *                     2.如果在其他线程中，调用quit
@@ -110,7 +194,7 @@ void EventLoop::quit()
  *
  * @param cb 回调函数
  */
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor cb, Priority priority)
 {
     if (isInLoopThread()) // 当前线程的loop循环中，执行cb
     {
@@ -118,7 +202,7 @@ void EventLoop::runInLoop(Functor cb)
     }
     else // 在非当前loop执行cb，就需要唤醒loop所在线程，执行cb
     {
-        queueInLoop(std::move(cb));
+        queueInLoop(std::move(cb), priority);
     }
 }
 
@@ -127,11 +211,17 @@ void EventLoop::runInLoop(Functor cb)
  *
  * @param cb 回调函数
  */
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor cb, Priority priority)
 {
+    if (isInLoopThread())
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
+        std::vector<Functor> &functors = priority == kUrgent ? localUrgentFunctors_ : localFunctors_;
+        functors.emplace_back(std::move(cb));
+    }
+    else
+    {
+        MpscQueue<Functor> &functors = priority == kUrgent ? urgentFunctors_ : pendingFunctors_;
+        functors.push(std::move(cb)); // 无锁
     }
 
     // 唤醒相应的，需要执行上面回调操作的loop线程
@@ -148,6 +238,12 @@ void EventLoop::queueInLoop(Functor cb)
  */
 void EventLoop::wakeup()
 {
+    // 只有handleRead清除标志后的第一个调用者需要写eventfd，其余的loop这一轮反正会处理
+    if (wakeupPending_.exchange(true))
+    {
+        return;
+    }
+    wakeupWrites_.fetch_add(1, std::memory_order_relaxed);
     uint64_t one = 1;
     ssize_t n = write(wakeupFd_, &one, sizeof(one));
     if (n != sizeof(one))
@@ -156,6 +252,39 @@ void EventLoop::wakeup()
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    int64_t delay = time.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    Timestamp when(Timestamp::monotonic().microSecondsSinceEpoch() + delay);
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::monotonic(), delay));
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::monotonic(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+TimingWheel *EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this));
+    }
+    return timingWheel_.get();
+}
+
 // 调用Poller方法
 void EventLoop::removeChannel(Channel *channel)
 {
@@ -175,28 +304,99 @@ bool EventLoop::hasChannel(Channel *channel)
 
 void EventLoop::handleRead() // wake up
 {
+    // 先清除标志再读，之后queueInLoop的调用者会重新写eventfd
+    // 清除之前入队的回调在本轮的doPendingFunctors中执行
+    wakeupPending_.store(false);
     uint64_t one = 1;
     ssize_t n = read(wakeupFd_, &one, sizeof(one));
     if (n != sizeof(one))
     {
-        LOG_ERROR("EventLoop::handleRead read %d bytes", n);
+        LOG_ERROR("EventLoop::handleRead read %zd bytes", n);
     }
 }
 
 void EventLoop::doPendingFunctors() // 执行回调
 {
-    std::vector<Functor> functors;//局部functors是为了保证注册回调的效率，及时释放掉锁
     callingPendingFunctors_ = true;
+    int64_t start = Timestamp::now().microSecondsSinceEpoch();
+    auto run = [](Functor &functor)
+    { functor(); };
 
+    // urgent回调全部执行
+    // 执行回调的过程中loop线程可能继续queueInLoop，先交换出来，新加入的留到下一轮
+    runningUrgentFunctors_.swap(localUrgentFunctors_);
+    for (const Functor &functor : runningUrgentFunctors_)
     {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_); // 减少锁带来的性能损耗
+        functor();
     }
+    size_t urgent = runningUrgentFunctors_.size();
+    runningUrgentFunctors_.clear();
+    // 其他线程提交的回调，drain只取当前已经可见的部分，不需要加锁
+    urgent += urgentFunctors_.drain(run);
+
+    // bulk回调受预算限制
+    size_t bulk = 0;
+    const size_t maxBulk = functorBudget_ > 0 ? functorBudget_ : SIZE_MAX;
+    bool exhausted = false;
+    auto budgetLeft = [&]()
+    {
+        if (bulk >= maxBulk)
+        {
+            exhausted = true;
+        }
+        else if (functorBudgetUs_ > 0 && bulk % kBudgetCheckInterval == 0 && bulk > 0)
+        {
+            exhausted = Timestamp::now().microSecondsSinceEpoch() - start >= functorBudgetUs_;
+        }
+        return !exhausted;
+    };
 
-    for (const Functor &functor : functors)
+    // 上一轮没执行完的先执行
+    if (runningIndex_ == runningFunctors_.size())
+    {
+        runningFunctors_.clear();
+        runningIndex_ = 0;
+        runningFunctors_.swap(localFunctors_);
+    }
+    while (runningIndex_ < runningFunctors_.size() && budgetLeft())
     {
+        // 移出来执行，执行完就释放捕获的对象
+        Functor functor(std::move(runningFunctors_[runningIndex_++]));
+        ++bulk;
         functor();
     }
 
+    if (functorBudget_ == 0 && functorBudgetUs_ == 0)
+    {
+        bulk += pendingFunctors_.drain(run);
+    }
+    else
+    {
+        // 有时间预算时分批drain，每批之间检查预算
+        while (budgetLeft())
+        {
+            size_t batch = std::min(maxBulk - bulk, kBudgetCheckInterval - bulk % kBudgetCheckInterval);
+            size_t n = pendingFunctors_.drain(run, batch);
+            bulk += n;
+            if (n < batch)
+            {
+                break;
+            }
+        }
+    }
+
+    FunctorStats &stats = functorStats_;
+    ++stats.iterations;
+    stats.urgentTotal += urgent;
+    stats.bulkTotal += bulk;
+    stats.lastUrgent = urgent;
+    stats.lastBulk = bulk;
+    stats.lastElapsedUs = Timestamp::now().microSecondsSinceEpoch() - start;
+    stats.lastCarried = exhausted && (runningIndex_ < runningFunctors_.size() || !pendingFunctors_.empty());
+    if (stats.lastCarried)
+    {
+        ++stats.budgetExhausted;
+    }
+
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+}
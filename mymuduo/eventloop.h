@@ -8,18 +8,67 @@
 #include <memory>
 #include <mutex>
 #include "current_thread.h"
+#include "callbacks.h"
+#include "timer_id.h"
+#include "mpsc_queue.h"
+#include "inplace_function.h"
+#include "poller.h"
+#include "buffer_pool.h"
 
-class Poller;
+class IoUringPoller;
 class Channel;
+class TimerQueue;
+class TimingWheel;
 
 // per thread per loop
 // 事件循环类 主要包含两个模块 Channel Pooller（封装epoll）
 class EventLoop : noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    // 不用std::function，捕获的对象放在内联缓冲区里，跨线程投递回调不需要堆分配
+    using Functor = InplaceFunction<void()>;
 
-    EventLoop();
+    /**
+     * @brief 回调的优先级
+     * kUrgent 连接建立/销毁、定时器增删等控制类回调，每轮全部执行，不受预算限制
+     * kBulk   send、用户任务等，受每轮预算限制，执行不完的留到下一轮
+     * 每轮先执行全部urgent回调，所以urgent回调会跑到之前提交的bulk回调前面：
+     *   同一个连接上需要和send保持顺序的操作（比如shutdown）必须用kBulk
+     *   urgent回调可以释放对象（比如connectDestroyde释放最后一个TcpConnectionPtr），
+     *   bulk回调不能持有裸指针，要持有shared_ptr
+     */
+    enum Priority
+    {
+        kUrgent,
+        kBulk,
+    };
+
+    // 每轮循环执行回调的统计，只能在loop线程中读取
+    struct FunctorStats
+    {
+        uint64_t iterations = 0;      // doPendingFunctors执行次数
+        uint64_t urgentTotal = 0;     // 执行的urgent回调总数
+        uint64_t bulkTotal = 0;       // 执行的bulk回调总数
+        uint64_t budgetExhausted = 0; // 预算用完、有回调留到下一轮的次数
+        size_t lastUrgent = 0;        // 最近一轮执行的urgent回调数
+        size_t lastBulk = 0;          // 最近一轮执行的bulk回调数
+        int64_t lastElapsedUs = 0;    // 最近一轮执行回调的耗时
+        bool lastCarried = false;     // 最近一轮是否有bulk回调留到下一轮
+    };
+
+    /**
+     * @brief 底层IO复用的实现
+     * kDefaultPoller 默认epoll，设置了环境变量MUDUO_USE_IOURING时使用io_uring
+     * kIoUringPoller 内核不支持io_uring时退回epoll
+     */
+    enum PollerType
+    {
+        kDefaultPoller,
+        kEpollPoller,
+        kIoUringPoller,
+    };
+
+    explicit EventLoop(PollerType pollerType = kDefaultPoller);
     ~EventLoop();
 
     /**
@@ -33,27 +82,96 @@ public:
      */
     void quit();
 
+    // 本轮poll返回的时间，loop线程中的回调用它代替Timestamp::now()，不需要再读时钟
     Timestamp pollReturnTime() const { return pollReturnTime_; }
+    // 同一时刻的单调时钟
+    Timestamp monotonicNow() const { return monotonicNow_; }
+    PollerType pollerType() const { return pollerType_; }
+    // 实际使用io_uring时返回对应的poller（可以提交完成式I/O），否则返回nullptr
+    IoUringPoller *ioUringPoller() const { return ioUringPoller_; }
+
+    /**
+     * @brief 忙轮询模式 阻塞在epoll_wait之前先用timeout=0轮询最多maxSpinUs微秒
+     * 实际自旋时长根据最近事件到达的间隔自适应，间隔超过maxSpinUs时不自旋
+     * 用CPU换延迟，需要在loop()之前设置，0表示关闭
+     */
+    void setBusyPoll(int maxSpinUs) { busyPollMaxUs_ = maxSpinUs; }
+    int busyPollMaxUs() const { return busyPollMaxUs_; }
+    int64_t spinBudgetUs() const { return spinBudgetUs_; }
+
+    /**
+     * @brief 一次poll最多取多少个就绪事件 事件数组在[minEvents, maxEvents]之间按负载伸缩
+     * 只对epoll有效，只能在loop线程中调用
+     */
+    void setPollEventLimits(size_t minEvents, size_t maxEvents) { poller_->setEventListLimits(minEvents, maxEvents); }
+    // 每次poll返回的事件数直方图等统计，只能在loop线程中读取
+    const Poller::PollStats &pollStats() const { return poller_->pollStats(); }
+
+    /**
+     * @brief Buffer::readFd的溢出缓冲区 可写空间不够时多读的数据先放这里再追加进Buffer
+     * 每个loop一块，loop上所有连接共用，只能在loop线程中使用和设置，0表示不用溢出缓冲区
+     */
+    static const size_t kDefaultExtraBufferSize = 64 * 1024;
+    void setExtraBufferSize(size_t size) { std::vector<char>(size).swap(extraBuffer_); }
+    char *extraBuffer() { return extraBuffer_.data(); }
+    size_t extraBufferSize() const { return extraBuffer_.size(); }
+    // 连接Buffer的存储池，只能在loop线程中使用
+    BufferPool *bufferPool() { return &bufferPool_; }
 
     /**
      * @brief 再当前线程中执行cb
      *
      * @param cb 回调函数
      */
-    void runInLoop(Functor cb);
+    void runInLoop(Functor cb, Priority priority = kBulk);
     /**
      * @brief 把cb放到队列中，唤醒loop所在的线程，执行cb
      *
      * @param cb 回调函数
+     * @param priority 回调优先级
      */
-    void queueInLoop(Functor cb);
+    void queueInLoop(Functor cb, Priority priority = kBulk);
 
     /**
-     * @brief 唤醒loop所在的线程
+     * @brief 每轮循环执行bulk回调的预算 避免大量回调饿死I/O事件
+     * 超出预算的回调留到下一轮，下一轮epoll_wait不阻塞，先处理I/O再继续执行
      *
+     * @param maxFunctors 每轮最多执行的bulk回调数 0表示不限制
+     * @param maxUs 每轮执行bulk回调的最长时间（微秒） 0表示不限制
+     */
+    void setFunctorBudget(size_t maxFunctors, int64_t maxUs)
+    {
+        functorBudget_ = maxFunctors;
+        functorBudgetUs_ = maxUs;
+    }
+    const FunctorStats &functorStats() const { return functorStats_; }
+
+    /**
+     * @brief 在time时刻（墙上时间）执行cb 线程安全
+     * 定时器按单调时钟计时，time在添加时换算成距离现在的间隔，之后修改系统时间不影响
+     *
+     * @return TimerId 可用于cancel
+     */
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器 线程安全
+    void cancel(TimerId timerId);
+
+    // 本loop的时间轮 第一次使用时创建，只能在loop线程中调用
+    TimingWheel *timingWheel();
+
+    /**
+     * @brief 唤醒loop所在的线程
+     * loop处理wakeupfd之前多次调用只会写一次eventfd
      */
     void wakeup();
 
+    // wakeup实际写eventfd的次数
+    uint64_t wakeupWrites() const { return wakeupWrites_.load(std::memory_order_relaxed); }
+
     // 调用Poller方法
     void removeChannel(Channel *channel);
     void updateChannel(Channel *channel);
@@ -66,23 +184,63 @@ private:
     void handleRead();        // wake up
     void doPendingFunctors(); // 执行回调
 
+    // 是否有待执行的回调 只能在loop线程调用
+    bool hasPendingFunctors() const
+    {
+        return runningIndex_ < runningFunctors_.size() || !localFunctors_.empty() || !localUrgentFunctors_.empty() ||
+               !pendingFunctors_.empty() || !urgentFunctors_.empty();
+    }
+    // 忙轮询模式下的poll
+    Timestamp busyPoll();
+    // 根据空闲等待了多久（从开始poll到有事件）调整自旋预算
+    void updateSpinBudget(int64_t idleUs);
+
     using ChannelList = std::vector<Channel *>;
     std::atomic_bool looping_; // 原子操作 通过CAS实现
     std::atomic_bool quit_;    // 标志退出loop循环
     const pid_t threadId_;     // 记录当前loop所在线程的id
     Timestamp pollReturnTime_; // poller返回发生时间的channels的时间点
+    Timestamp monotonicNow_;   // 每轮poll返回时更新
+
+    int busyPollMaxUs_;    // 最大自旋时间 0表示不自旋
+    int64_t spinBudgetUs_; // 当前自旋预算
+    int64_t idleGapUs_;    // 空闲等待时间的滑动平均
 
+    // 构造时请求的类型，newDefaultPoller据此选择实现，必须在poller_之前初始化
+    const PollerType pollerType_;
     // one loop one poller
     std::unique_ptr<Poller> poller_;
+    IoUringPoller *ioUringPoller_;
 
     int wakeupFd_; // 当mainLoop获取一个新用户的channel，通过轮询选择一个subLoop处理线程
     std::unique_ptr<Channel> wakeupChannel_;
+    std::atomic_bool wakeupPending_;      // 已经写过eventfd，loop还没有读
+    std::atomic<uint64_t> wakeupWrites_; // 写eventfd的系统调用次数
+
+    // 定时器队列 依赖poller_，必须在poller_之后构造
+    std::unique_ptr<TimerQueue> timerQueue_;
+    // 时间轮由timerQueue_驱动，必须先于timerQueue_析构
+    std::unique_ptr<TimingWheel> timingWheel_;
 
     // poll返回的有revents的channel
     ChannelList activeChannels_;
     // Channel *currentActiveChannel_;
 
     std::atomic_bool callingPendingFunctors_; // 表示当前loop是否有需要执行回调的地方
-    std::vector<Functor> pendingFunctors_;    // 存储loop需要执行的所有回调操作
-    std::mutex mutex_;                        // 线程安全
+    MpscQueue<Functor> pendingFunctors_;      // 其他线程提交的回调 每个生产者线程一个无锁环形队列
+    std::vector<Functor> localFunctors_;      // loop线程自己提交的回调 只有loop线程访问 不需要加锁
+    std::vector<Functor> runningFunctors_;    // 和localFunctors_交换 复用内存
+    size_t runningIndex_;                     // runningFunctors_中下一个要执行的位置，预算用完时保留剩下的
+
+    // urgent回调 数量少，不受预算限制
+    MpscQueue<Functor> urgentFunctors_;
+    std::vector<Functor> localUrgentFunctors_;
+    std::vector<Functor> runningUrgentFunctors_;
+
+    size_t functorBudget_;
+    int64_t functorBudgetUs_;
+    FunctorStats functorStats_;
+
+    std::vector<char> extraBuffer_; // 所有连接共用的readv溢出缓冲区
+    BufferPool bufferPool_;         // 块大小是Buffer的初始容量
 };
\ No newline at end of file
@@ -7,7 +7,9 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb, const std::string
       thread_(std::bind(&EventLoopThread::threadFunc, this), name),
       mutex_(),
       cond_(),
-      callback_(cb)
+      callback_(cb),
+      busyPollUs_(0),
+      pollerType_(EventLoop::kDefaultPoller)
 {
 }
 EventLoopThread::~EventLoopThread()
@@ -39,7 +41,8 @@ EventLoop *EventLoopThread::startLoop()
 // thread_->start => 【子线程中调用】thread_->func() => EventLoopThread::threadFunc()
 void EventLoopThread::threadFunc()
 {
-    EventLoop loop; // 创建一个独立的eventloop，one loop one thread
+    EventLoop loop(pollerType_); // 创建一个独立的eventloop，one loop one thread
+    loop.setBusyPoll(busyPollUs_);
 
     // 初始化回调初始化loop
     if (callback_)
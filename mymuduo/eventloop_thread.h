@@ -1,14 +1,13 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "eventloop.h"
 #include <functional>
 #include "thread.h"
 #include <mutex>
 #include <condition_variable>
 #include <string>
 
-class EventLoop;
-
 class EventLoopThread : noncopyable
 {
 public:
@@ -25,6 +24,11 @@ public:
      */
     EventLoop *startLoop();
 
+    // 新loop的忙轮询时间，startLoop之前设置，见EventLoop::setBusyPoll
+    void setBusyPoll(int maxSpinUs) { busyPollUs_ = maxSpinUs; }
+    // 新loop使用的Poller，startLoop之前设置
+    void setPollerType(EventLoop::PollerType type) { pollerType_ = type; }
+
 private:
     void threadFunc();
 
@@ -34,4 +38,6 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    int busyPollUs_;
+    EventLoop::PollerType pollerType_;
 };
\ No newline at end of file
@@ -7,7 +7,9 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseloop, const std::string
       name_(nameArg),
       started_(false),
       numThreads_(0),
-      next_(0)
+      next_(0),
+      busyPollUs_(0),
+      pollerType_(EventLoop::kDefaultPoller)
 {
 }
 
@@ -26,6 +28,8 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
         char buf[name_.size() + 32];
         snprintf(buf, sizeof(buf), "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        t->setBusyPoll(busyPollUs_);
+        t->setPollerType(pollerType_);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop()); // 创建线程，绑定一个新的eventloop，并返回该loop地址
     }
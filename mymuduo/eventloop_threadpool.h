@@ -1,11 +1,11 @@
 #pragma once
 #include "noncopyable.h"
+#include "eventloop.h"
 #include <functional>
 #include <string>
 #include <vector>
 #include <memory>
 
-class EventLoop;
 class EventLoopThread;
 
 class EventLoopThreadPool : noncopyable
@@ -17,6 +17,10 @@ public:
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    // subloop的忙轮询时间，start之前设置，baseloop（accept）不受影响
+    void setBusyPoll(int maxSpinUs) { busyPollUs_ = maxSpinUs; }
+    // subloop使用的Poller，start之前设置
+    void setPollerType(EventLoop::PollerType type) { pollerType_ = type; }
 
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
@@ -35,6 +39,8 @@ private:
     bool started_;
     int numThreads_;
     int next_;
+    int busyPollUs_;
+    EventLoop::PollerType pollerType_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // 包含所有创建的线程指针
     std::vector<EventLoop *> loops_;
 };
\ No newline at end of file
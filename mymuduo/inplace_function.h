@@ -0,0 +1,131 @@
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 默认内联缓冲区大小，一个cache line，够放 成员函数指针+this+shared_ptr+两个参数
+const size_t kInplaceFunctionCapacity = 64;
+
+template <typename Signature, size_t Capacity = kInplaceFunctionCapacity>
+class InplaceFunction;
+
+/**
+ * @brief 只能移动的函数对象 捕获的对象直接放在内部固定大小的缓冲区里
+ * std::function捕获超过16字节就要堆分配，跨线程queueInLoop每次都会new/delete
+ * 捕获的对象超过Capacity时编译报错，而不是悄悄退化成堆分配
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    InplaceFunction() noexcept : ops_(nullptr) {}
+    InplaceFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename F,
+              typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, InplaceFunction>::value>::type>
+    InplaceFunction(F &&f)
+    {
+        static_assert(sizeof(Fn) <= Capacity, "InplaceFunction: callable is larger than the inline buffer");
+        static_assert(alignof(Fn) <= alignof(Storage), "InplaceFunction: callable is over-aligned");
+        new (&storage_) Fn(std::forward<F>(f));
+        ops_ = &OpsFor<Fn>::ops;
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept
+        : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(&other.storage_, &storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            ops_ = other.ops_;
+            if (ops_)
+            {
+                ops_->move(&other.storage_, &storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction &) = delete;
+    InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    // 和std::function一样，const调用可以修改捕获的状态 不能调用空的InplaceFunction
+    R operator()(Args... args) const
+    {
+        assert(ops_ != nullptr && "InplaceFunction: calling an empty function");
+        return ops_->invoke(const_cast<Storage *>(&storage_), std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+private:
+    using Storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    // 每种被捕获的类型一张静态函数表，相当于手写的虚函数表
+    struct Ops
+    {
+        R (*invoke)(Storage *, Args &&...);
+        void (*move)(Storage *from, Storage *to);
+        void (*destroy)(Storage *);
+    };
+
+    template <typename Fn>
+    struct OpsFor
+    {
+        static R invoke(Storage *s, Args &&...args)
+        {
+            return (*reinterpret_cast<Fn *>(s))(std::forward<Args>(args)...);
+        }
+        static void move(Storage *from, Storage *to)
+        {
+            Fn *f = reinterpret_cast<Fn *>(from);
+            new (to) Fn(std::move(*f));
+            f->~Fn();
+        }
+        static void destroy(Storage *s)
+        {
+            reinterpret_cast<Fn *>(s)->~Fn();
+        }
+        static const Ops ops;
+    };
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops *ops_;
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename Fn>
+const typename InplaceFunction<R(Args...), Capacity>::Ops
+    InplaceFunction<R(Args...), Capacity>::OpsFor<Fn>::ops = {
+        &OpsFor<Fn>::invoke, &OpsFor<Fn>::move, &OpsFor<Fn>::destroy};
@@ -0,0 +1,613 @@
+#include "io_uring_poller.h"
+#include "channel.h"
+#include "logger.h"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+// 和EpollPoller一样用channel的index_记录状态
+// channel未添加到poller中
+const int kNew = -1;
+// channel已添加到poller中
+const int kAdded = 1;
+// channel从poller中删除
+const int kDeleted = 2;
+
+// io_uring内部请求（比如POLL_REMOVE自己）的user_data，完成事件直接忽略
+const uint64_t kInternalUserData = 0;
+// Operation请求的user_data = Operation地址 | kOperationTag
+// poll请求的代数只用31位，保证最高位为0
+const uint64_t kOperationTag = 1ULL << 63;
+const uint32_t kMaxGeneration = 0x7fffffff;
+
+static int ioUringSetup(unsigned entries, struct io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argsz));
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringfd_(-1),
+      sqRingPtr_(MAP_FAILED),
+      sqRingSize_(0),
+      cqRingPtr_(MAP_FAILED),
+      cqRingSize_(0),
+      sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+      sqesSize_(0),
+      sqLocalTail_(0),
+      nextGeneration_(0),
+      recvMultishot_(true),
+      recvBufferRingReady_(false),
+      recvBufRing_(nullptr),
+      recvBuffers_(nullptr),
+      recvBufTail_(0)
+{
+    if (!setupRing())
+    {
+        LOG_ERROR("IoUringPoller::IoUringPoller io_uring setup failed errno:%d\n", errno);
+        if (ringfd_ >= 0)
+        {
+            ::close(ringfd_);
+            ringfd_ = -1;
+        }
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (recvBuffers_)
+    {
+        ::munmap(recvBuffers_, kRecvBufferCount * kRecvBufferSize);
+    }
+    if (recvBufRing_)
+    {
+        ::munmap(recvBufRing_, kRecvBufferCount * sizeof(struct io_uring_buf));
+    }
+    if (sqes_ != MAP_FAILED)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRingPtr_ != MAP_FAILED && cqRingPtr_ != sqRingPtr_)
+    {
+        ::munmap(cqRingPtr_, cqRingSize_);
+    }
+    if (sqRingPtr_ != MAP_FAILED)
+    {
+        ::munmap(sqRingPtr_, sqRingSize_);
+    }
+    if (ringfd_ >= 0)
+    {
+        ::close(ringfd_); // 关闭ring会取消所有还在等待的poll请求
+    }
+}
+
+bool IoUringPoller::setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCqEntries;
+
+    ringfd_ = ioUringSetup(kSqEntries, &params);
+    if (ringfd_ < 0)
+    {
+        return false;
+    }
+    // EXT_ARG用于带超时的等待，POLL_32BITS用于传递EPOLLET等高位事件
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_POLL_32BITS))
+    {
+        errno = ENOSYS;
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRingPtr_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if (sqRingPtr_ == MAP_FAILED)
+    {
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRingPtr_ = sqRingPtr_;
+    }
+    else
+    {
+        cqRingPtr_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_CQ_RING);
+        if (cqRingPtr_ == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sqRingPtr_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqFlags_ = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+
+    char *cq = static_cast<char *>(cqRingPtr_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * @brief 收割完成事件，没有完成事件或者有请求要提交时才进入内核
+ *
+ * @param timeoutMs 超时时间ms
+ * @param activeChannels 将监听到的事件列表填到ChannelList，告知EventLoop
+ * @return Timestamp
+ */
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_DEBUG("IoUringPoller::poll  channels_.size %zu\n", channels_.size());
+
+    rearm();
+
+    size_t firstNew = activeChannels->size();
+    // SQ满时在reserveSqes中收割到的事件，channel已经删除的revents_被清零了
+    for (int fd : deferredFds_)
+    {
+        Channel *channel = channels_.find(fd);
+        if (channel != nullptr && revents_[fd] != 0)
+        {
+            activeChannels->push_back(channel);
+        }
+    }
+    deferredFds_.clear();
+    reapCompletions(activeChannels);
+    bool cqOverflow = __atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW;
+    bool idle = activeChannels->empty() && completions_.empty();
+    if (idle || pendingSqes() > 0 || cqOverflow)
+    {
+        // 已经有事件时只提交不等待
+        int waitMs = idle ? timeoutMs : 0;
+        if (enter(waitMs != 0 ? 1 : 0, waitMs) >= 0 || errno == ETIME || errno == EINTR)
+        {
+            reapCompletions(activeChannels);
+        }
+        else
+        {
+            LOG_ERROR("%s io_uring_enter failed errno:%d\n", __FUNCTION__, errno);
+        }
+    }
+
+    // 两次收割到的同一个channel的事件合并成一次回调
+    for (size_t i = firstNew; i < activeChannels->size(); i++)
+    {
+        Channel *channel = (*activeChannels)[i];
+        channel->set_revents(revents_[channel->fd()]);
+        revents_[channel->fd()] = 0;
+    }
+    recordPoll(activeChannels->size() - firstNew + completions_.size());
+    runCompletions();
+    return Timestamp::now();
+}
+
+void IoUringPoller::runCompletions()
+{
+    // 回调里可能提交新请求，甚至重入getSqe->enter，先换出来再执行
+    runningCompletions_.swap(completions_);
+    for (const Completion &c : runningCompletions_)
+    {
+        c.op->handler(c.res, c.flags);
+    }
+    runningCompletions_.clear();
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+    unsigned flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *argp = nullptr;
+    size_t argsz = 0;
+
+    if (minComplete > 0 || (__atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW))
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    if (minComplete > 0 && timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        memset(&arg, 0, sizeof arg);
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof arg;
+    }
+
+    // 等待超时返回-ETIME时请求也已经提交了，待提交数以内核的sq head为准
+    return ioUringEnter(ringfd_, pendingSqes(), minComplete, flags, argp, argsz);
+}
+
+void IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe *cqe = &cqes_[head & cqMask_];
+        uint64_t userData = cqe->user_data;
+        if (userData == kInternalUserData)
+        {
+            continue;
+        }
+        if (userData & kOperationTag)
+        {
+            Operation *op = reinterpret_cast<Operation *>(static_cast<uintptr_t>(userData & ~kOperationTag));
+            completions_.push_back(Completion{op, cqe->res, cqe->flags});
+            continue;
+        }
+
+        int fd = static_cast<int>(userData & 0xffffffff);
+        uint32_t generation = static_cast<uint32_t>(userData >> 32);
+        if (fd < 0 || static_cast<size_t>(fd) >= generations_.size() || generations_[fd] != generation)
+        {
+            continue; // 已经删除或者重新提交过的poll请求
+        }
+        Channel *channel = channels_.find(fd);
+        if (channel == nullptr)
+        {
+            continue;
+        }
+
+        // 单次poll请求（或者被内核终止的multishot）完成了，回调执行完以后再重新提交
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+        {
+            generations_[fd] = 0;
+            rearmFds_.push_back(fd);
+        }
+
+        int revents = cqe->res < 0 ? (cqe->res == -ECANCELED ? 0 : static_cast<int>(EPOLLERR)) : cqe->res;
+        if (revents != 0)
+        {
+            if (revents_[fd] == 0)
+            {
+                activeChannels->push_back(channel);
+            }
+            revents_[fd] |= revents;
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::rearm()
+{
+    // submitPollAdd在SQ满时会收割CQ，可能往rearmFds_里追加，先换出来
+    rearmingFds_.swap(rearmFds_);
+    for (int fd : rearmingFds_)
+    {
+        // 回调中被删除、修改过（已经重新提交）的跳过
+        Channel *channel = channels_.find(fd);
+        if (channel != nullptr && generations_[fd] == 0 &&
+            channel->index() == kAdded && !channel->isNoneEvent())
+        {
+            submitPollAdd(channel);
+        }
+    }
+    rearmingFds_.clear();
+}
+
+void IoUringPoller::reserveSqes(unsigned count)
+{
+    while (pendingSqes() + count > sqEntries_)
+    {
+        // 可能在channel回调或者Operation回调中，这里只收割不分发
+        ChannelList ready;
+        reapCompletions(&ready);
+        for (Channel *channel : ready)
+        {
+            deferredFds_.push_back(channel->fd());
+        }
+        // 可能只提交了一部分，循环直到空出足够的位置
+        if (enter(0, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            LOG_FATAL("%s io_uring_enter failed errno:%d\n", __FUNCTION__, errno);
+        }
+    }
+}
+
+struct io_uring_sqe *IoUringPoller::getSqe()
+{
+    // SQ满了，先把已有的请求提交给内核
+    reserveSqes(1);
+    unsigned index = sqLocalTail_ & sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    return sqe;
+}
+
+static inline uint32_t pollEvents(const Channel *channel)
+{
+    return static_cast<uint32_t>(channel->events() | (channel->edgeTriggered() ? static_cast<uint32_t>(EPOLLET) : 0u));
+}
+
+// sqe填好以后发布tail，下一次io_uring_enter时提交
+static inline void publishSqe(unsigned *sqTail, unsigned tail)
+{
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::submitPollAdd(Channel *channel)
+{
+    int fd = channel->fd();
+    // 代数全局递增，fd关闭后被复用也不会和旧请求的代数相同
+    if (++nextGeneration_ > kMaxGeneration)
+    {
+        nextGeneration_ = 1;
+    }
+    generations_[fd] = nextGeneration_;
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // 单次poll，fd仍然就绪时重新提交会立即完成，相当于水平触发
+    // 边沿触发的channel用multishot+EPOLLET，一直有效，不需要重新提交
+    sqe->len = channel->edgeTriggered() ? IORING_POLL_ADD_MULTI : 0;
+    sqe->poll32_events = pollEvents(channel);
+    sqe->user_data = encode(fd, nextGeneration_);
+    publishSqe(sqTail_, sqLocalTail_);
+}
+
+void IoUringPoller::submitPollUpdate(Channel *channel)
+{
+    int fd = channel->fd();
+    if (generations_[fd] == 0)
+    {
+        // 请求已经完成，等待重新提交，直接用新的事件提交
+        submitPollAdd(channel);
+        return;
+    }
+    if (channel->edgeTriggered())
+    {
+        // 原地修改multishot+EPOLLET请求的事件后不会再报告新的边沿，删掉重新提交
+        submitPollRemove(fd);
+        submitPollAdd(channel);
+        return;
+    }
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encode(fd, generations_[fd]);
+    sqe->len = IORING_POLL_UPDATE_EVENTS;
+    sqe->poll32_events = pollEvents(channel);
+    sqe->user_data = kInternalUserData;
+    publishSqe(sqTail_, sqLocalTail_);
+}
+
+void IoUringPoller::submitPollRemove(int fd)
+{
+    if (generations_[fd] == 0)
+    {
+        return;
+    }
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encode(fd, generations_[fd]);
+    sqe->user_data = kInternalUserData;
+    publishSqe(sqTail_, sqLocalTail_);
+    // 之后这个fd上旧请求的完成事件都按代数丢弃
+    generations_[fd] = 0;
+}
+
+// 更新Channel channel update remove => Eventloop =>Poller
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_DEBUG("%s => fd=%d events=%d index=%d\n", __FUNCTION__, fd, channel->events(), index);
+
+    if (static_cast<size_t>(fd) >= generations_.size())
+    {
+        generations_.resize(fd + 1, 0);
+        revents_.resize(fd + 1, 0);
+    }
+
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            channels_.insert(fd, channel);
+        }
+        channel->set_index(kAdded);
+        submitPollAdd(channel);
+    }
+    else // channel已经在poller上注册过了
+    {
+        if (channel->isNoneEvent())
+        {
+            submitPollRemove(fd);
+            channel->set_index(kDeleted);
+        }
+        else
+        {
+            submitPollUpdate(channel);
+        }
+    }
+}
+
+// 从ChannelMap里面删除
+// 注意POLL_REMOVE在下一次poll时才提交，在那之前内核仍然持有fd对应的文件
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    int index = channel->index();
+    channels_.erase(fd);
+    if (index == kAdded)
+    {
+        submitPollRemove(fd);
+    }
+    if (static_cast<size_t>(fd) < revents_.size())
+    {
+        revents_[fd] = 0;
+    }
+    channel->set_index(kNew);
+}
+
+bool IoUringPoller::setupRecvBufferRing()
+{
+    recvBufferRingReady_ = true;
+    size_t ringSize = kRecvBufferCount * sizeof(struct io_uring_buf);
+    void *ring = ::mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void *buffers = ::mmap(nullptr, kRecvBufferCount * kRecvBufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED || buffers == MAP_FAILED)
+    {
+        LOG_ERROR("%s mmap failed errno:%d\n", __FUNCTION__, errno);
+        if (ring != MAP_FAILED)
+        {
+            ::munmap(ring, ringSize);
+        }
+        if (buffers != MAP_FAILED)
+        {
+            ::munmap(buffers, kRecvBufferCount * kRecvBufferSize);
+        }
+        return false;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof reg);
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = kRecvBufferCount;
+    reg.bgid = kRecvBufferGroup;
+    if (ioUringRegister(ringfd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        LOG_ERROR("%s IORING_REGISTER_PBUF_RING failed errno:%d\n", __FUNCTION__, errno);
+        ::munmap(ring, ringSize);
+        ::munmap(buffers, kRecvBufferCount * kRecvBufferSize);
+        return false;
+    }
+
+    recvBufRing_ = static_cast<struct io_uring_buf_ring *>(ring);
+    recvBuffers_ = static_cast<char *>(buffers);
+    for (unsigned bid = 0; bid < kRecvBufferCount; bid++)
+    {
+        recycleRecvBuffer(bid << IORING_CQE_BUFFER_SHIFT);
+    }
+    return true;
+}
+
+bool IoUringPoller::submitRecvMultishot(int fd, Operation *op)
+{
+    if (!recvBufferRingReady_)
+    {
+        recvMultishot_ = setupRecvBufferRing();
+    }
+    if (!recvMultishot_)
+    {
+        return false;
+    }
+
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kRecvBufferGroup;
+    sqe->user_data = reinterpret_cast<uintptr_t>(op) | kOperationTag;
+    publishSqe(sqTail_, sqLocalTail_);
+    return true;
+}
+
+bool IoUringPoller::hasMore(uint32_t cqeFlags)
+{
+    return cqeFlags & IORING_CQE_F_MORE;
+}
+
+const char *IoUringPoller::recvBuffer(uint32_t cqeFlags) const
+{
+    unsigned bid = cqeFlags >> IORING_CQE_BUFFER_SHIFT;
+    return recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize;
+}
+
+void IoUringPoller::recycleRecvBuffer(uint32_t cqeFlags)
+{
+    unsigned bid = cqeFlags >> IORING_CQE_BUFFER_SHIFT;
+    // 不能用io_uring_buf_ring::bufs：C++里__DECLARE_FLEX_ARRAY的空结构体占1字节，bufs会偏移8字节
+    // 环就是io_uring_buf数组，tail和第0项的resv重叠
+    struct io_uring_buf *bufs = reinterpret_cast<struct io_uring_buf *>(recvBufRing_);
+    struct io_uring_buf *buf = &bufs[recvBufTail_ & (kRecvBufferCount - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+    buf->len = kRecvBufferSize;
+    buf->bid = static_cast<uint16_t>(bid);
+    ++recvBufTail_;
+    __atomic_store_n(&bufs[0].resv, recvBufTail_, __ATOMIC_RELEASE);
+}
+
+int IoUringPoller::submitSend(int fd, const char *data, size_t len, Operation *op)
+{
+    int count = static_cast<int>(std::min<size_t>((len + kSendChunk - 1) / kSendChunk, kMaxSendChain));
+    // 一条链必须在同一次io_uring_enter中提交，SQ剩余空间不够就先把已有的提交掉
+    reserveSqes(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        size_t n = len < kSendChunk ? len : kSendChunk;
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(n);
+        // 没有MSG_WAITALL时短写也算成功，链上后面的请求照样执行，流里会留下空洞
+        // 有MSG_WAITALL时内核会继续发完，发不完才算失败并取消链上后面的请求
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->flags = i + 1 < count ? IOSQE_IO_LINK : 0;
+        sqe->user_data = reinterpret_cast<uintptr_t>(op) | kOperationTag;
+        data += n;
+        len -= n;
+    }
+    publishSqe(sqTail_, sqLocalTail_);
+    return count;
+}
+
+void IoUringPoller::submitCancel(Operation *op)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uintptr_t>(op) | kOperationTag;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = kInternalUserData;
+    publishSqe(sqTail_, sqLocalTail_);
+}
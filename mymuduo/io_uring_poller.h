@@ -0,0 +1,161 @@
+#pragma once
+#include "poller.h"
+#include "inplace_function.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @brief 基于io_uring的Poller 每个fd提交一个IORING_OP_POLL_ADD
+ * 内核不接受IORING_POLL_ADD_LEVEL，multishot是边沿触发的，所以用单次poll，
+ * 回调执行完以后重新提交：fd仍然就绪时请求立即完成，和EpollPoller一样是水平触发
+ * 边沿触发的channel用multishot+EPOLLET，不需要重新提交
+ * 兴趣事件变化用IORING_POLL_UPDATE_EVENTS原地修改，所有请求在poll时随io_uring_enter一次提交
+ * CQ里已经有完成事件时直接收割，不需要系统调用
+ *
+ * 除了就绪通知，还提供基于完成事件的recv/send（见Operation），供TcpConnection的completion I/O模式使用
+ *
+ * 不依赖liburing，直接使用io_uring_setup/io_uring_enter系统调用
+ */
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // 内核不支持或者io_uring被禁用时返回false，由newDefaultPoller退回epoll
+    bool valid() const { return ringfd_ >= 0; }
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    /**
+     * @brief 一个异步请求的完成回调 res是对应系统调用的返回值（失败为-errno），flags是cqe->flags
+     * 回调在poll中、EventLoop分发channel事件之前执行
+     * 请求完成（cqe没有IORING_CQE_F_MORE）之前Operation对象必须一直有效
+     */
+    struct Operation
+    {
+        InplaceFunction<void(int res, uint32_t flags), 32> handler;
+    };
+
+    /**
+     * @brief 提交multishot recv 数据收到loop共享的provided buffer ring中
+     * 每个cqe带一个缓冲区id，用recvBuffer取数据，用完必须马上recycleRecvBuffer归还
+     *
+     * @return false 内核不支持provided buffer ring，调用者应该退回就绪通知+read
+     */
+    bool submitRecvMultishot(int fd, Operation *op);
+    const char *recvBuffer(uint32_t cqeFlags) const;
+    // multishot请求是否还会有后续的完成事件
+    static bool hasMore(uint32_t cqeFlags);
+    void recycleRecvBuffer(uint32_t cqeFlags);
+    // 内核不接受multishot recv时调用，之后submitRecvMultishot都返回false
+    void disableRecvMultishot() { recvMultishot_ = false; }
+
+    /**
+     * @brief 提交send data在全部完成之前必须保持有效
+     * 按kSendChunk切成最多kMaxSendChain个用IOSQE_IO_LINK链接的请求，按顺序执行，超出部分由调用者在完成后再提交
+     * 每个请求带MSG_WAITALL，内核在发送缓冲区满时等待而不是短写返回；只有出错时才会发不完，
+     * 这时后面的请求以-ECANCELED完成，已完成的字节总是流的一段连续前缀
+     *
+     * @return int 提交的请求数，op会收到同样多个完成事件
+     */
+    int submitSend(int fd, const char *data, size_t len, Operation *op);
+    // 取消op上所有未完成的请求，它们以-ECANCELED完成
+    void submitCancel(Operation *op);
+
+private:
+    static const unsigned kSqEntries = 256;
+    static const unsigned kCqEntries = 4096;
+    // provided buffer ring：kRecvBufferCount个kRecvBufferSize大小的缓冲区，loop内所有连接共享
+    static const unsigned kRecvBufferCount = 256;
+    static const unsigned kRecvBufferSize = 4096;
+    static const uint16_t kRecvBufferGroup = 0;
+    static const size_t kSendChunk = 64 * 1024;
+    static const int kMaxSendChain = 8;
+
+    struct Completion
+    {
+        Operation *op;
+        int res;
+        uint32_t flags;
+    };
+
+    bool setupRing();
+
+    // 取一个空闲的sqe，SQ满了先提交
+    struct io_uring_sqe *getSqe();
+    // 保证SQ至少有count个空位 内核暂时不接收请求（CQ溢出、EINTR、EAGAIN）时先把CQ收割掉再重试，
+    // 填好的sqe不会被覆盖；收割到的事件记在deferredFds_和completions_里，下一次poll再分发
+    void reserveSqes(unsigned count);
+    void submitPollAdd(Channel *channel);
+    void submitPollUpdate(Channel *channel);
+    void submitPollRemove(int fd);
+    // 重新提交上一轮完成的poll请求
+    void rearm();
+
+    // 提交并等待至少minComplete个完成事件，timeoutMs<0表示一直等
+    int enter(unsigned minComplete, int timeoutMs);
+    // 已经填好、内核还没有取走的sqe数
+    unsigned pendingSqes() const { return sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE); }
+    // 收割CQ中所有完成事件，revents先累加在revents_中，Operation的完成事件放到completions_
+    void reapCompletions(ChannelList *activeChannels);
+    // 执行收割到的Operation回调
+    void runCompletions();
+
+    bool setupRecvBufferRing();
+
+    static uint64_t encode(int fd, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    int ringfd_;
+
+    void *sqRingPtr_;
+    size_t sqRingSize_;
+    void *cqRingPtr_;
+    size_t cqRingSize_;
+    struct io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqFlags_;
+    unsigned *sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned sqLocalTail_; // 还没有对内核可见的tail
+
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    // 按fd索引：当前生效的poll请求的代数，0表示没有提交poll
+    // user_data = 代数<<32 | fd，过期请求（已删除/重新提交）的完成事件按代数丢弃
+    std::vector<uint32_t> generations_;
+    uint32_t nextGeneration_;
+    // 上一轮完成了poll请求的fd，下一次poll时重新提交
+    std::vector<int> rearmFds_;
+    std::vector<int> rearmingFds_;
+    // reserveSqes中收割到就绪事件的fd，事件累加在revents_中
+    std::vector<int> deferredFds_;
+
+    std::vector<Completion> completions_;
+    std::vector<Completion> runningCompletions_;
+
+    bool recvMultishot_;                     // provided buffer ring可用
+    bool recvBufferRingReady_;               // 已经尝试过注册
+    struct io_uring_buf_ring *recvBufRing_; // 和内核共享的缓冲区环
+    char *recvBuffers_;                      // kRecvBufferCount * kRecvBufferSize
+    uint16_t recvBufTail_;
+    // 按fd索引：本轮收割到的revents，多个完成事件合并成一次回调
+    std::vector<int> revents_;
+};
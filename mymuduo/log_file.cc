@@ -0,0 +1,123 @@
+#include "log_file.h"
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+LogFile::LogFile(const std::string &basename, off_t rollSize, int rollIntervalSeconds, bool syncOnFlush)
+    : basename_(basename),
+      rollSize_(rollSize),
+      rollIntervalSeconds_(rollIntervalSeconds),
+      syncOnFlush_(syncOnFlush),
+      fp_(nullptr),
+      writtenBytes_(0),
+      startOfPeriod_(0),
+      lastRoll_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        flush();
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *data, size_t len)
+{
+    time_t now = ::time(nullptr);
+    if (writtenBytes_ > rollSize_ ||
+        (rollIntervalSeconds_ > 0 && now / rollIntervalSeconds_ * rollIntervalSeconds_ != startOfPeriod_))
+    {
+        rollFile();
+    }
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+
+    // 后台线程独占FILE，不需要stdio的锁
+    size_t written = 0;
+    while (written < len)
+    {
+        size_t n = ::fwrite_unlocked(data + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            int err = ::ferror(fp_);
+            if (err)
+            {
+                fprintf(stderr, "LogFile::append() failed %s\n", strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+}
+
+void LogFile::flush()
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    ::fflush(fp_);
+    if (syncOnFlush_)
+    {
+        ::fsync(::fileno(fp_));
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = ::time(nullptr);
+    // 同一秒内文件名相同，继续写当前文件
+    if (fp_ != nullptr && now == lastRoll_)
+    {
+        return false;
+    }
+
+    std::string filename = getLogFileName(basename_, now);
+    FILE *fp = ::fopen(filename.c_str(), "ae"); // e: O_CLOEXEC
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "LogFile::rollFile() open %s failed errno:%d\n", filename.c_str(), errno);
+        return false;
+    }
+    if (fp_)
+    {
+        flush();
+        ::fclose(fp_);
+    }
+    fp_ = fp;
+    ::setvbuf(fp_, buffer_, _IOFBF, sizeof buffer_);
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    startOfPeriod_ = rollIntervalSeconds_ > 0 ? now / rollIntervalSeconds_ * rollIntervalSeconds_ : 0;
+    return true;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t now)
+{
+    std::string filename(basename);
+
+    char timebuf[32];
+    struct tm tm;
+    ::gmtime_r(&now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if (::gethostname(hostname, sizeof hostname - 1) != 0)
+    {
+        strcpy(hostname, "unknownhost");
+    }
+    filename += hostname;
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
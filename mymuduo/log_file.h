@@ -0,0 +1,49 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * @brief 日志文件 按大小和时间滚动
+ * 文件名 basename.YYYYmmdd-HHMMSS.hostname.pid.log
+ * 不是线程安全的，只由AsyncLogging的后台线程使用
+ */
+class LogFile : noncopyable
+{
+public:
+    /**
+     * @param basename 文件名前缀，可以带目录
+     * @param rollSize 当前文件超过rollSize字节时换新文件
+     * @param rollIntervalSeconds 每隔多少秒换新文件（按整周期对齐，默认每天零点UTC），0表示不按时间滚动
+     * @param syncOnFlush flush时fsync，掉电不丢日志
+     */
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int rollIntervalSeconds = 24 * 3600,
+            bool syncOnFlush = false);
+    ~LogFile();
+
+    void append(const char *data, size_t len);
+    void flush();
+    // 换新文件 同一秒内不会重复换
+    bool rollFile();
+
+    off_t writtenBytes() const { return writtenBytes_; }
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int rollIntervalSeconds_;
+    const bool syncOnFlush_;
+
+    FILE *fp_;
+    off_t writtenBytes_;  // 当前文件已写的字节数
+    time_t startOfPeriod_; // 当前文件所属周期的起点
+    time_t lastRoll_;
+    char buffer_[64 * 1024]; // FILE的缓冲区，减少write次数
+};
@@ -1,28 +1,97 @@
 #include "logger.h"
-#include <iostream>
+#include <string.h>
+#include <time.h>
+#include <stdarg.h>
+#include <algorithm>
+
+namespace
+{
+    // 同一秒内的日志复用格式化好的时间，不用每行都localtime
+    __thread time_t t_lastSecond = 0;
+    __thread char t_time[32];
+    __thread int t_timeLen = 0;
+
+    const char *kLevelNames[] = {"[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]"};
+
+    // 前缀 + 1KB消息 + 换行
+    const size_t kMaxLine = 1024 + 64;
+}
+
+// MUDEBUG打开时运行期默认也输出DEBUG
+std::atomic<int> Logger::logLevel_{MUDUO_MIN_LOG_LEVEL};
+std::atomic<BinaryLogging *> Logger::binarySink_{nullptr};
+
+void Logger::flush()
+{
+    if (flush_)
+    {
+        flush_();
+    }
+    else
+    {
+        ::fflush(stdout);
+    }
+}
 
 //[级别信息] time : msg
-void Logger::log(std::string msg)
+void Logger::log(LogLevel level, const char *format, ...)
 {
-    switch (loglevel_)
-    {
-    case INFO:
-        std::cout << "[INFO]";
-        break;
-    case ERROR:
-        std::cout << "[ERROR]";
-        break;
-    case FATAL:
-        std::cout << "[FATAL]";
-        break;
-    case DEBUG:
-        std::cout << "[DEBUG]";
-        break;
-    default:
-        break;
+    char line[kMaxLine];
+    size_t len = 0;
+    if (level >= DEBUG && level <= FATAL)
+    {
+        size_t n = strlen(kLevelNames[level]);
+        memcpy(line, kLevelNames[level], n);
+        len += n;
     }
 
     //打印时间和msg
-    std::cout << Timestamp::now().toString()
-              << ":" << msg << std::endl;
-}
\ No newline at end of file
+    Timestamp now = Timestamp::now();
+    time_t seconds = static_cast<time_t>(now.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond);
+    if (seconds != t_lastSecond)
+    {
+        struct tm tm_time;
+        ::localtime_r(&seconds, &tm_time);
+        t_timeLen = snprintf(t_time, sizeof t_time, "%4d/%02d/%02d %02d:%02d:%02d",
+                             tm_time.tm_year + 1900, tm_time.tm_mon + 1,
+                             tm_time.tm_mday, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+    memcpy(line + len, t_time, t_timeLen);
+    len += t_timeLen;
+    line[len++] = ':';
+
+    // 直接格式化到行缓冲区里，留一个字节给换行
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + len, sizeof line - len - 1, format, args);
+    va_end(args);
+    if (n > 0)
+    {
+        len += std::min(static_cast<size_t>(n), sizeof line - len - 2);
+    }
+    // 大部分调用的格式串已经带了换行
+    if (line[len - 1] != '\n')
+    {
+        line[len++] = '\n';
+    }
+
+    if (output_)
+    {
+        output_(line, len);
+    }
+    else
+    {
+        ::fwrite(line, 1, len, stdout);
+    }
+
+    // stdout由stdio缓冲，错误马上刷出去；异步后端只在退出进程前等待落盘
+    if (level == FATAL && flush_)
+    {
+        flush_();
+    }
+    else if ((level == ERROR || level == FATAL) && !output_)
+    {
+        ::fflush(stdout);
+    }
+}
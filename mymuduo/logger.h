@@ -2,71 +2,89 @@
 
 #include "noncopyable.h"
 #include "timestamp.h"
+#include "binary_logging.h"
 #include <string>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
 
-// ##__VA_ARGS__ 输入任意参数占位符
-// LOGINFO("%s %d",arg1,arg2)
-#define LOG_INFO(logmsgFormat, ...)                       \
-    do                                                    \
-    {                                                     \
-        Logger &log = Logger::instance();                 \
-        log.set_loglevel(INFO);                           \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        log.log(buf);                                     \
+// 定义日志级别 从低到高 DEBUG INFO ERROR FATAL
+enum LogLevel
+{
+    DEBUG, // 调试信息
+    INFO,  // 普通信息
+    ERROR, // 错误信息
+    FATAL, // core信息
+};
+
+// 编译期最低日志级别 低于它的LOG_*调用连同参数求值一起被编译器删掉，可以用-DMUDUO_MIN_LOG_LEVEL=ERROR指定
+// 兼容原来的MUDEBUG：没有定义MUDEBUG时LOG_DEBUG不参与编译
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL DEBUG
+#else
+#define MUDUO_MIN_LOG_LEVEL INFO
+#endif
+#endif
+
+// 设置了二进制日志时只记录调用点id和参数，否则格式化成文本
+#define MUDUO_LOG_RECORD(level, logmsgFormat, ...)                                      \
+    do                                                                                  \
+    {                                                                                   \
+        BinaryLogging *muduoBinaryLog = Logger::binarySink();                           \
+        if (muduoBinaryLog)                                                             \
+        {                                                                               \
+            static const LogSite muduoLogSite((level), logmsgFormat, __FILE__, __LINE__); \
+            muduoBinaryLog->record(muduoLogSite, ##__VA_ARGS__);                        \
+            if ((level) == FATAL)                                                       \
+            {                                                                           \
+                muduoBinaryLog->flush();                                                \
+                Logger::instance().flush();                                             \
+            }                                                                           \
+        }                                                                               \
+        else                                                                            \
+        {                                                                               \
+            Logger::instance().log((level), logmsgFormat, ##__VA_ARGS__);               \
+        }                                                                               \
     } while (0)
 
-// LOGINFO("%s %d",arg1,arg2)
-#define LOG_ERROR(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &log = Logger::instance();                 \
-        log.set_loglevel(ERROR);                          \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        log.log(buf);                                     \
+// 先比较级别再格式化，关闭的级别只有一次分支
+#define MUDUO_LOG_IMPL(level, logmsgFormat, ...)                      \
+    do                                                                \
+    {                                                                 \
+        if ((level) >= MUDUO_MIN_LOG_LEVEL && Logger::enabled(level)) \
+        {                                                             \
+            MUDUO_LOG_RECORD(level, logmsgFormat, ##__VA_ARGS__);     \
+        }                                                             \
     } while (0)
 
+// ##__VA_ARGS__ 输入任意参数占位符
 // LOGINFO("%s %d",arg1,arg2)
-#define LOG_FATAL(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &log = Logger::instance();                 \
-        log.set_loglevel(FATAL);                          \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        log.log(buf);                                     \
-        exit(-1);                                         \
-    } while (0)
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
 
 // LOGINFO("%s %d",arg1,arg2)
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &log = Logger::instance();                 \
-        log.set_loglevel(DEBUG);                          \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        log.log(buf);                                     \
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+
+// FATAL不受级别限制，打印后退出进程
+#define LOG_FATAL(logmsgFormat, ...)                       \
+    do                                                     \
+    {                                                      \
+        MUDUO_LOG_RECORD(FATAL, logmsgFormat, ##__VA_ARGS__); \
+        exit(-1);                                          \
     } while (0)
-#else
-#define LOG_DEBUG(logmsgFormat, ...)
-#endif
 
-// 定义日志级别 INFO ERROR FATAL DEBUG
-enum LogLevel
-{
-    INFO,  // 普通信息
-    ERROR, // 错误信息
-    FATAL, // core信息
-    DEBUG, // 调试信息
-};
+// LOGINFO("%s %d",arg1,arg2)
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
 
 // 输出一个日志类
 class Logger : noncopyable
 {
 public:
+    // 日志输出的目的地 msg是格式化好的一整行（带换行）
+    using OutputFunc = std::function<void(const char *msg, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
     // local static单体模式 线程安全 获取日志唯一的实例对象
     static Logger &instance()
     {
@@ -74,14 +92,37 @@ public:
         return logger;
     }
 
-    // 设置日志级别
-    void set_loglevel(int level) { loglevel_ = level; }
+    // 运行期日志级别 低于它的日志不格式化直接丢掉，线程安全
+    static LogLevel logLevel() { return static_cast<LogLevel>(logLevel_.load(std::memory_order_relaxed)); }
+    static void setLogLevel(LogLevel level) { logLevel_.store(level, std::memory_order_relaxed); }
+    static bool enabled(LogLevel level) { return level >= logLevel_.load(std::memory_order_relaxed); }
+
+    // 写日志 级别随每条日志传入，不修改共享状态
+    void log(LogLevel level, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
-    // 写日志
-    void log(std::string msg);
+    /**
+     * @brief 设置日志输出 默认写stdout，可以换成AsyncLogging::append
+     * 不是线程安全的，需要在其他线程开始打日志之前设置
+     */
+    void setOutput(OutputFunc output) { output_ = std::move(output); }
+    // LOG_FATAL退出进程之前调用
+    void setFlush(FlushFunc flush) { flush_ = std::move(flush); }
+    // 调用setFlush设置的函数，没有设置时刷新stdout
+    void flush();
+
+    /**
+     * @brief 二进制延迟格式化日志 设置以后LOG_*不再格式化，只记录参数，见BinaryLogging
+     * 线程安全，nullptr恢复文本日志；BinaryLogging析构之前必须先恢复
+     */
+    static BinaryLogging *binarySink() { return binarySink_.load(std::memory_order_acquire); }
+    static void setBinarySink(BinaryLogging *sink) { binarySink_.store(sink, std::memory_order_release); }
 
 private:
     Logger(/* args */) = default;
 
-    int loglevel_ = 0;
+    static std::atomic<int> logLevel_;
+    static std::atomic<BinaryLogging *> binarySink_;
+
+    OutputFunc output_;
+    FlushFunc flush_;
 };
@@ -0,0 +1,433 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief 多生产者单消费者队列 由每个生产者线程各自的SPSC环形队列组成
+ *
+ *  producer1 ──> Ring1 ──┐
+ *  producer2 ──> Ring2 ──┼──> consumer(loop线程) drain
+ *  producer3 ──> Ring3 ──┘
+ *
+ * 生产者第一次push时注册自己的Ring（无锁链表头插），之后push/drain都不需要加锁
+ * Ring满了以后退化为该Ring上带锁的overflow队列，在消费者取走overflow之前
+ * 该生产者后续的元素都进overflow，保证同一个生产者的元素先进先出
+ *
+ * 每个线程在线程局部的登记表里记录自己在各个队列上的Ring，push只查登记表，不遍历共享链表
+ * 生产者线程退出时（pthread key的析构函数）把它的Ring标记为orphaned，
+ * 消费者取空之后从链表摘下释放，短命线程调用queueInLoop不会让Ring越积越多
+ * Ring由队列和生产者线程共同持有（引用计数），两边都放手才释放
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    static const size_t kDefaultRingCapacity = 1024;
+
+    explicit MpscQueue(size_t ringCapacity = kDefaultRingCapacity)
+        : capacity_(roundUpPowerOfTwo(ringCapacity)),
+          id_(nextId()),
+          rings_(nullptr),
+          cursor_(nullptr)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        Ring *ring = rings_.load(std::memory_order_acquire);
+        while (ring)
+        {
+            Ring *next = ring->nextRing;
+            // 生产者线程可能还活着，Ring要等它从登记表里清掉，剩下的元素现在就析构
+            ring->clear();
+            ring->queueGone.store(true, std::memory_order_release);
+            ring->release();
+            ring = next;
+        }
+    }
+
+    // 任意线程调用，同一个线程的元素按push顺序被消费
+    void push(T &&item)
+    {
+        Ring *ring = localRing();
+        if (ring->overflowed.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(ring->mutex);
+            if (ring->overflowed.load(std::memory_order_relaxed))
+            {
+                ring->overflow.push_back(std::move(item));
+                return;
+            }
+        }
+
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (tail - ring->cachedHead == capacity_)
+        {
+            ring->cachedHead = ring->head.load(std::memory_order_acquire);
+            if (tail - ring->cachedHead == capacity_)
+            {
+                std::lock_guard<std::mutex> lock(ring->mutex);
+                ring->overflow.push_back(std::move(item));
+                ring->overflowed.store(true, std::memory_order_release);
+                return;
+            }
+        }
+        new (ring->slot(tail)) T(std::move(item));
+        ring->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 只能由消费者线程调用 依次取出元素并执行func(item)
+     * 每个Ring只取调用时已经可见的元素，执行过程中新push的留到下一次
+     * 从上一次停下的Ring的下一个开始轮转，max限制下每次调用都从不同的生产者开始，
+     * 先注册的生产者不会占满每一批，后面的生产者也能取到
+     *
+     * @param max 本次最多取出的元素个数
+     * @return size_t 实际取出的个数
+     */
+    template <typename Func>
+    size_t drain(Func &&func, size_t max = SIZE_MAX)
+    {
+        size_t n = 0;
+        Ring *start = cursor_ != nullptr ? cursor_ : rings_.load(std::memory_order_acquire);
+        Ring *ring = start;
+        Ring *prev = nullptr; // start的前驱不知道，start不在这一次摘除
+        bool wrapped = false;
+        while (ring != nullptr && n < max)
+        {
+            Ring *next = ring->nextRing;
+            n += drainRing(ring, func, max - n);
+
+            if (ring != start && reclaimable(ring))
+            {
+                unlink(prev, ring);
+                ring->release();
+            }
+            else
+            {
+                prev = ring;
+            }
+
+            // 到了表尾从表头接着取，回到start为止
+            if (next == nullptr && !wrapped)
+            {
+                wrapped = true;
+                next = rings_.load(std::memory_order_acquire);
+                prev = nullptr;
+            }
+            ring = next;
+            if (wrapped && ring == start)
+            {
+                break;
+            }
+        }
+        // 下一次从最后访问的Ring的下一个开始，取完一整圈时从start的下一个开始
+        cursor_ = ring == start && start != nullptr ? start->nextRing : ring;
+        return n;
+    }
+
+    // 只能由消费者线程调用
+    bool empty() const
+    {
+        for (Ring *ring = rings_.load(std::memory_order_acquire); ring; ring = ring->nextRing)
+        {
+            if (ring->carryIndex < ring->carry.size() ||
+                ring->overflowed.load(std::memory_order_acquire) ||
+                ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // 单个生产者的环形队列 head只由消费者修改，tail只由生产者修改
+    struct Ring
+    {
+        explicit Ring(size_t capacity)
+            : mask(capacity - 1),
+              storage(static_cast<char *>(::operator new(capacity * sizeof(T)))),
+              head(0),
+              cachedHead(0),
+              tail(0),
+              overflowed(false),
+              carryIndex(0),
+              orphaned(false),
+              queueGone(false),
+              refs(2),
+              nextRing(nullptr)
+        {
+        }
+
+        ~Ring()
+        {
+            clear();
+            ::operator delete(storage);
+        }
+
+        // 析构还没有取走的元素
+        void clear()
+        {
+            size_t end = tail.load(std::memory_order_acquire);
+            for (size_t i = head.load(std::memory_order_relaxed); i != end; ++i)
+            {
+                slot(i)->~T();
+            }
+            head.store(end, std::memory_order_relaxed);
+            overflow.clear();
+            carry.clear();
+            carryIndex = 0;
+        }
+
+        // 队列和生产者线程各持有一个引用
+        void release()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                delete this;
+            }
+        }
+
+        T *slot(size_t index) { return reinterpret_cast<T *>(storage + (index & mask) * sizeof(T)); }
+
+        const size_t mask;
+        char *const storage;
+
+        // head和tail分别被消费者和生产者写，放在不同的cache line上避免伪共享
+        char pad0[64];
+        std::atomic<size_t> head;
+        char pad1[64];
+        size_t cachedHead; // 生产者缓存的head，减少跨核读取
+        std::atomic<size_t> tail;
+        char pad2[64];
+
+        std::atomic_bool overflowed;
+        std::mutex mutex;
+        std::vector<T> overflow;
+
+        // 消费者私有：已经从overflow取出但还没执行的元素
+        std::vector<T> carry;
+        size_t carryIndex;
+
+        std::atomic_bool orphaned;  // 生产者线程已经退出，不会再push
+        std::atomic_bool queueGone; // 队列已经析构
+        std::atomic<int> refs;
+
+        Ring *nextRing; // 只有消费者遍历和摘除，生产者只在表头插入
+    };
+
+    // 线程局部的登记表 每个(线程, 队列)一个Ring
+    struct Registry
+    {
+        struct Entry
+        {
+            uint64_t queueId;
+            Ring *ring;
+        };
+        std::vector<Entry> entries;
+        size_t last = 0; // 上一次命中的位置，一个线程通常连续往同一个loop提交
+    };
+
+    // 当前线程在本队列上的Ring
+    Ring *localRing()
+    {
+        Registry *registry = t_registry;
+        if (registry != nullptr)
+        {
+            if (registry->last < registry->entries.size() && registry->entries[registry->last].queueId == id_)
+            {
+                return registry->entries[registry->last].ring;
+            }
+            for (size_t i = 0; i < registry->entries.size(); i++)
+            {
+                if (registry->entries[i].queueId == id_)
+                {
+                    registry->last = i;
+                    return registry->entries[i].ring;
+                }
+            }
+        }
+        return createRing();
+    }
+
+    Ring *createRing()
+    {
+        Registry *registry = t_registry;
+        if (registry == nullptr)
+        {
+            registry = new Registry;
+            t_registry = registry;
+            ::pthread_setspecific(registryKey(), registry);
+        }
+        // 顺便清掉已经析构的队列的Ring
+        std::vector<typename Registry::Entry> &entries = registry->entries;
+        for (size_t i = 0; i < entries.size();)
+        {
+            if (entries[i].ring->queueGone.load(std::memory_order_acquire))
+            {
+                entries[i].ring->release();
+                entries[i] = entries.back();
+                entries.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        Ring *ring = new Ring(capacity_);
+        ring->nextRing = rings_.load(std::memory_order_relaxed);
+        while (!rings_.compare_exchange_weak(ring->nextRing, ring,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+        {
+        }
+        entries.push_back(typename Registry::Entry{id_, ring});
+        registry->last = entries.size() - 1;
+        return ring;
+    }
+
+    // 生产者线程退出
+    static void destroyRegistry(void *arg)
+    {
+        Registry *registry = static_cast<Registry *>(arg);
+        t_registry = nullptr;
+        for (const typename Registry::Entry &entry : registry->entries)
+        {
+            // 之前push的元素对看到orphaned的消费者可见
+            entry.ring->orphaned.store(true, std::memory_order_release);
+            entry.ring->release();
+        }
+        delete registry;
+    }
+
+    static pthread_key_t registryKey()
+    {
+        struct Key
+        {
+            Key() { ::pthread_key_create(&key, &MpscQueue::destroyRegistry); }
+            pthread_key_t key;
+        };
+        static Key key;
+        return key.key;
+    }
+
+    // 取出一个Ring里的元素，最多max个
+    template <typename Func>
+    static size_t drainRing(Ring *ring, Func &func, size_t max)
+    {
+        size_t n = 0;
+        // 上一次没执行完的overflow元素比Ring里的都早
+        while (ring->carryIndex < ring->carry.size() && n < max)
+        {
+            T item(std::move(ring->carry[ring->carryIndex++]));
+            ++n;
+            func(item);
+        }
+        if (ring->carryIndex < ring->carry.size())
+        {
+            return n;
+        }
+        ring->carry.clear();
+        ring->carryIndex = 0;
+
+        // 先读overflowed再读tail，保证进overflow之前放入Ring的元素都能看到
+        bool overflowed = ring->overflowed.load(std::memory_order_acquire);
+        size_t tail = ring->tail.load(std::memory_order_acquire);
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        while (head != tail && n < max)
+        {
+            T *slot = ring->slot(head);
+            T item(std::move(*slot));
+            slot->~T();
+            ring->head.store(++head, std::memory_order_release);
+            ++n;
+            func(item);
+        }
+
+        if (overflowed && head == tail)
+        {
+            {
+                std::lock_guard<std::mutex> lock(ring->mutex);
+                ring->carry.swap(ring->overflow);
+                ring->overflowed.store(false, std::memory_order_release);
+            }
+            while (ring->carryIndex < ring->carry.size() && n < max)
+            {
+                T item(std::move(ring->carry[ring->carryIndex++]));
+                ++n;
+                func(item);
+            }
+            if (ring->carryIndex == ring->carry.size())
+            {
+                ring->carry.clear();
+                ring->carryIndex = 0;
+            }
+        }
+        return n;
+    }
+
+    // 生产者已经退出并且取空了的Ring 只能由消费者调用
+    static bool reclaimable(Ring *ring)
+    {
+        return ring->orphaned.load(std::memory_order_acquire) &&
+               ring->carryIndex == ring->carry.size() &&
+               !ring->overflowed.load(std::memory_order_acquire) &&
+               ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire);
+    }
+
+    // 从链表摘下ring，prev是遍历时ring的前一个 表头可能同时有生产者插入新Ring
+    void unlink(Ring *prev, Ring *ring)
+    {
+        if (prev == nullptr)
+        {
+            Ring *expected = ring;
+            if (rings_.compare_exchange_strong(expected, ring->nextRing, std::memory_order_acq_rel))
+            {
+                return;
+            }
+            // 表头插入了新Ring，ring的前驱在新插入的这一段里
+            prev = expected;
+            while (prev->nextRing != ring)
+            {
+                prev = prev->nextRing;
+            }
+        }
+        prev->nextRing = ring->nextRing;
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t size = 1;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    // 队列的全局唯一id，避免队列析构后地址被复用导致线程局部缓存命中旧Ring
+    static uint64_t nextId()
+    {
+        static std::atomic<uint64_t> id{0};
+        return ++id;
+    }
+
+    const size_t capacity_;
+    const uint64_t id_;
+    std::atomic<Ring *> rings_; // 所有生产者Ring组成的链表
+    Ring *cursor_;              // 消费者私有：下一次drain开始的Ring，nullptr表示从表头开始
+
+    static thread_local Registry *t_registry;
+};
+
+template <typename T>
+thread_local typename MpscQueue<T>::Registry *MpscQueue<T>::t_registry = nullptr;
@@ -0,0 +1,168 @@
+#include "output_queue.h"
+#include <algorithm>
+#include <errno.h>
+
+OutputQueue::OutputQueue(BufferPool *pool)
+    : pool_(pool),
+      bytes_(0)
+{
+}
+
+OutputQueue::Segment::~Segment()
+{
+    switch (kind)
+    {
+    case kBuffer:
+        buffer.~Buffer();
+        break;
+    case kString:
+        string.~basic_string();
+        break;
+    case kShared:
+        slice.~SharedSlice();
+        break;
+    }
+}
+
+void OutputQueue::setPool(BufferPool *pool)
+{
+    pool_ = pool;
+    for (Segment &segment : segments_)
+    {
+        if (segment.kind == Segment::kBuffer)
+        {
+            segment.buffer.setPool(pool);
+        }
+    }
+}
+
+void OutputQueue::append(const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    if (len >= kCopyThreshold)
+    {
+        append(std::string(data, len));
+        return;
+    }
+    // 小块数据合并到队尾的Buffer
+    if (!canCoalesce())
+    {
+        segments_.emplace_back(pool_);
+    }
+    segments_.back().buffer.append(data, len);
+    bytes_ += len;
+}
+
+void OutputQueue::append(std::string &&data, size_t offset)
+{
+    if (offset >= data.size())
+    {
+        return;
+    }
+    segments_.emplace_back(std::move(data), offset);
+    bytes_ += segments_.back().size();
+}
+
+void OutputQueue::append(Buffer *buf)
+{
+    size_t len = buf->readableBytes();
+    if (len == 0)
+    {
+        return;
+    }
+    if (len < kCopyThreshold && canCoalesce())
+    {
+        // 小块数据拷贝合并比多一个分段划算
+        segments_.back().buffer.append(buf->peek(), len);
+        buf->retrieveAll();
+    }
+    else
+    {
+        // 分段用buf的池，交换之后buf的池不变
+        segments_.emplace_back(buf->pool());
+        segments_.back().buffer.swap(*buf);
+    }
+    bytes_ += len;
+}
+
+void OutputQueue::append(const SharedSlice &slice, size_t offset)
+{
+    if (offset >= slice.size())
+    {
+        return;
+    }
+    size_t len = slice.size() - offset;
+    if (len < kMinShare)
+    {
+        append(slice.data() + offset, len);
+        return;
+    }
+    // 分段只持有引用
+    segments_.emplace_back(slice, offset);
+    bytes_ += len;
+}
+
+void OutputQueue::retrieve(size_t len)
+{
+    if (len >= bytes_)
+    {
+        retrieveAll();
+        return;
+    }
+    bytes_ -= len;
+    while (len > 0)
+    {
+        Segment &segment = segments_.front();
+        size_t n = std::min(len, segment.size());
+        if (segment.kind == Segment::kBuffer)
+        {
+            segment.buffer.retrieve(n);
+        }
+        else
+        {
+            segment.offset += n;
+        }
+        len -= n;
+        if (segment.size() == 0)
+        {
+            segments_.pop_front();
+        }
+    }
+}
+
+void OutputQueue::retrieveAll()
+{
+    segments_.clear();
+    bytes_ = 0;
+}
+
+int OutputQueue::fillIovec(struct iovec *iov, int maxIov) const
+{
+    int count = 0;
+    for (const Segment &segment : segments_)
+    {
+        if (count == maxIov)
+        {
+            break;
+        }
+        iov[count].iov_base = const_cast<char *>(segment.data());
+        iov[count].iov_len = segment.size();
+        ++count;
+    }
+    return count;
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *saveErrno) const
+{
+    struct iovec iov[kMaxWriteSegments];
+    int count = fillIovec(iov, kMaxWriteSegments);
+    ssize_t n = count == 1 ? ::write(fd, iov[0].iov_base, iov[0].iov_len) : ::writev(fd, iov, count);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
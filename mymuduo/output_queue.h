@@ -0,0 +1,103 @@
+#pragma once
+#include "noncopyable.h"
+#include "buffer.h"
+#include "shared_slice.h"
+#include <list>
+#include <new>
+#include <string>
+#include <sys/uio.h>
+
+class BufferPool;
+
+/**
+ * @brief TcpConnection的输出队列 待发送的数据按顺序排成一串分段，用writev一次发出去（最多kMaxWriteSegments段）
+ * 分段有三种：
+ *   Buffer 拷贝进来的小块数据合并在队尾的Buffer里，超过kMaxCoalesce再开一个新的
+ *   string 移交进来的std::string（send(std::string&&)），或者不小于kCopyThreshold的数据拷贝一次成为单独的分段
+ *   shared 引用SharedSlice的共享存储，同一份数据排在多个连接的队列里也只有一份
+ * 已经排队的数据不会因为后面追加而被再次拷贝或者挪动
+ * 只能在loop线程中使用
+ */
+class OutputQueue : noncopyable
+{
+public:
+    // 拷贝进来的数据不小于这个长度时单独成段，不合并
+    static const size_t kCopyThreshold = 4 * 1024;
+    // 合并用的Buffer超过这个长度就不再往里追加
+    static const size_t kMaxCoalesce = 64 * 1024;
+    // SharedSlice短于这个长度时拷贝合并，比多一个分段和引用计数划算
+    static const size_t kMinShare = 128;
+    // 一次writev最多的分段数
+    static const int kMaxWriteSegments = 64;
+
+    explicit OutputQueue(BufferPool *pool = nullptr);
+
+    // Buffer分段的存储池，见Buffer::setPool
+    void setPool(BufferPool *pool);
+
+    size_t readableBytes() const { return bytes_; }
+    size_t segmentCount() const { return segments_.size(); }
+
+    // 拷贝
+    void append(const char *data, size_t len);
+    // 移交所有权，从offset开始的部分排队，不拷贝
+    void append(std::string &&data, size_t offset = 0);
+    // 把buf的内容换进来，buf变空，不拷贝
+    void append(Buffer *buf);
+    // 引用slice从offset开始的部分，不拷贝
+    void append(const SharedSlice &slice, size_t offset = 0);
+
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 把可读数据填到iov里，最多maxIov个，返回填了几个
+    int fillIovec(struct iovec *iov, int maxIov) const;
+    // writev最多kMaxWriteSegments个分段，和Buffer::writeFd一样不取走数据
+    ssize_t writeFd(int fd, int *saveErrno) const;
+
+private:
+    // 三种分段同时只有一种有效，用kind区分
+    struct Segment : noncopyable
+    {
+        enum Kind
+        {
+            kBuffer,
+            kString,
+            kShared
+        };
+
+        explicit Segment(BufferPool *pool) : offset(0), kind(kBuffer) { new (&buffer) Buffer(Buffer::kInitialSize, pool); }
+        Segment(std::string &&data, size_t off) : offset(off), kind(kString) { new (&string) std::string(std::move(data)); }
+        Segment(const SharedSlice &data, size_t off) : offset(off), kind(kShared) { new (&slice) SharedSlice(data); }
+        ~Segment();
+
+        const char *data() const
+        {
+            return kind == kBuffer ? buffer.peek() : (kind == kString ? string.data() : slice.data()) + offset;
+        }
+        size_t size() const
+        {
+            return kind == kBuffer ? buffer.readableBytes() : (kind == kString ? string.size() : slice.size()) - offset;
+        }
+
+        union
+        {
+            Buffer buffer;      // kBuffer
+            std::string string; // kString
+            SharedSlice slice;  // kShared
+        };
+        size_t offset; // string和slice已经取走的字节数
+        Kind kind;
+    };
+
+    // 队尾是还能继续合并的Buffer分段
+    bool canCoalesce() const
+    {
+        return !segments_.empty() && segments_.back().kind == Segment::kBuffer &&
+               segments_.back().buffer.readableBytes() < kMaxCoalesce;
+    }
+
+    BufferPool *pool_;
+    std::list<Segment> segments_; // 空的list不分配内存，空闲连接不占额外空间
+    size_t bytes_;
+};
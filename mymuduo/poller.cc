@@ -6,9 +6,21 @@ Poller::Poller(EventLoop *loop)
 {
 }
 
+void Poller::recordPoll(size_t numEvents)
+{
+    ++pollStats_.polls;
+    pollStats_.events += numEvents;
+    int bucket = 0;
+    while (numEvents > 0 && bucket < kHistogramBuckets - 1)
+    {
+        numEvents >>= 1;
+        ++bucket;
+    }
+    ++pollStats_.histogram[bucket];
+}
+
 // 判断参数channnel是否在当前Poller中
 bool Poller::hasChannel(Channel *channel) const
 {
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return channels_.find(channel->fd()) == channel;
 }
\ No newline at end of file
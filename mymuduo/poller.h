@@ -1,7 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
 #include "timestamp.h"
 #include "noncopyable.h"
 
@@ -17,6 +18,19 @@ class Poller : noncopyable
 public:
     using ChannelList = std::vector<Channel *>;
 
+    static const int kHistogramBuckets = 16;
+
+    // 每次poll返回的就绪事件数统计，只能在loop线程中读取
+    struct PollStats
+    {
+        uint64_t polls = 0;      // poll调用次数
+        uint64_t events = 0;     // 返回的就绪事件总数
+        uint64_t drains = 0;     // 事件数组填满后用timeout=0再取一次的次数
+        size_t eventListSize = 0; // 当前事件数组大小
+        // 按log2分桶：桶0是0个事件，桶i(i>0)是[2^(i-1), 2^i)个，最后一个桶包括更大的
+        uint64_t histogram[kHistogramBuckets] = {};
+    };
+
     Poller(EventLoop *loop);
     virtual ~Poller() = default;
 
@@ -30,13 +44,63 @@ public:
     // 判断参数channnel是否在当前Poller中
     bool hasChannel(Channel *channel) const;
 
+    /**
+     * @brief 一次poll最多取多少个就绪事件
+     * 事件数组在[minEvents, maxEvents]之间按负载伸缩，不需要事件数组的实现忽略
+     */
+    virtual void setEventListLimits(size_t /*minEvents*/, size_t /*maxEvents*/) {}
+
+    const PollStats &pollStats() const { return pollStats_; }
+
     // EvenntLoop可以通过该接口获取默认的IO复用的具体实现
     // one loop one poller 不需要线程安全
     static Poller *newDefaultPoller(EventLoop *loop);
 
 protected:
-    // sockfd : Channel
-    using ChannelMap = std::unordered_map<int, Channel *>;
+    // 记录一次poll返回的就绪事件数
+    void recordPoll(size_t numEvents);
+
+    PollStats pollStats_;
+
+    /**
+     * @brief sockfd : Channel 直接用fd做vector下标
+     * 内核总是分配最小的可用fd，fd很稠密，比哈希表少一次哈希、每个连接少一次节点分配
+     */
+    class ChannelMap
+    {
+    public:
+        ChannelMap() : size_(0) {}
+
+        Channel *find(int fd) const
+        {
+            return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+        }
+        void insert(int fd, Channel *channel)
+        {
+            if (static_cast<size_t>(fd) >= channels_.size())
+            {
+                channels_.resize(fd + 1, nullptr); // resize按容量倍增，均摊O(1)
+            }
+            if (channels_[fd] == nullptr)
+            {
+                ++size_;
+            }
+            channels_[fd] = channel;
+        }
+        void erase(int fd)
+        {
+            if (static_cast<size_t>(fd) < channels_.size() && channels_[fd] != nullptr)
+            {
+                channels_[fd] = nullptr;
+                --size_;
+            }
+        }
+        size_t size() const { return size_; }
+
+    private:
+        std::vector<Channel *> channels_;
+        size_t size_;
+    };
     ChannelMap channels_;
 
 private:
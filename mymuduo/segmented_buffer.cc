@@ -0,0 +1,229 @@
+#include "segmented_buffer.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+SegmentedBuffer::SegmentedBuffer(size_t slabSize)
+    : slabSize_(slabSize > 0 ? slabSize : kDefaultSlabSize),
+      spare_{nullptr, 0, 0, 0},
+      readable_(0)
+{
+}
+
+SegmentedBuffer::~SegmentedBuffer()
+{
+    for (const Slab &slab : slabs_)
+    {
+        delete[] slab.data;
+    }
+    delete[] spare_.data;
+}
+
+void SegmentedBuffer::swap(SegmentedBuffer &rhs)
+{
+    // slabSize_是常量，两边不同时交换后各自按自己的大小分配新slab
+    slabs_.swap(rhs.slabs_);
+    std::swap(spare_, rhs.spare_);
+    std::swap(readable_, rhs.readable_);
+}
+
+SegmentedBuffer::Slab SegmentedBuffer::newSlab(size_t capacity)
+{
+    if (spare_.data && spare_.capacity >= capacity)
+    {
+        Slab slab = spare_;
+        spare_.data = nullptr;
+        slab.read = slab.write = 0;
+        return slab;
+    }
+    Slab slab = {new char[capacity], capacity, 0, 0};
+    return slab;
+}
+
+void SegmentedBuffer::freeSlab(const Slab &slab)
+{
+    // 只留一个标准大小的备用，pullup拼出来的大slab直接释放
+    if (spare_.data == nullptr && slab.capacity == slabSize_)
+    {
+        spare_ = slab;
+    }
+    else
+    {
+        delete[] slab.data;
+    }
+}
+
+SegmentedBuffer::Slab &SegmentedBuffer::writableSlab()
+{
+    if (slabs_.empty() || slabs_.back().write == slabs_.back().capacity)
+    {
+        slabs_.push_back(newSlab(slabSize_));
+    }
+    return slabs_.back();
+}
+
+void SegmentedBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
+    {
+        Slab &slab = writableSlab();
+        size_t n = std::min(len, slab.capacity - slab.write);
+        memcpy(slab.data + slab.write, data, n);
+        slab.write += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void SegmentedBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+    readable_ -= len;
+    while (len > 0)
+    {
+        Slab &slab = slabs_.front();
+        size_t n = std::min(len, slab.write - slab.read);
+        slab.read += n;
+        len -= n;
+        if (slab.read == slab.write)
+        {
+            freeSlab(slab);
+            slabs_.pop_front();
+        }
+    }
+}
+
+void SegmentedBuffer::retrieveAll()
+{
+    // 保留第一个slab复用，其余释放
+    while (slabs_.size() > 1)
+    {
+        freeSlab(slabs_.back());
+        slabs_.pop_back();
+    }
+    if (!slabs_.empty())
+    {
+        slabs_.front().read = slabs_.front().write = 0;
+    }
+    readable_ = 0;
+}
+
+std::string SegmentedBuffer::retrieveAsString(size_t len)
+{
+    len = std::min(len, readable_);
+    std::string result;
+    result.reserve(len);
+    size_t remaining = len;
+    for (const Slab &slab : slabs_)
+    {
+        if (remaining == 0)
+        {
+            break;
+        }
+        size_t n = std::min(remaining, slab.write - slab.read);
+        result.append(slab.data + slab.read, n);
+        remaining -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+const char *SegmentedBuffer::pullup(size_t len)
+{
+    if (len > readable_)
+    {
+        return nullptr;
+    }
+    if (len <= firstSegmentBytes())
+    {
+        return peek();
+    }
+
+    // 前len字节拷到一个新slab，放在链的最前面
+    Slab merged = newSlab(std::max(len, slabSize_));
+    size_t remaining = len;
+    while (remaining > 0)
+    {
+        Slab &slab = slabs_.front();
+        size_t n = std::min(remaining, slab.write - slab.read);
+        memcpy(merged.data + merged.write, slab.data + slab.read, n);
+        merged.write += n;
+        slab.read += n;
+        remaining -= n;
+        if (slab.read == slab.write)
+        {
+            freeSlab(slab);
+            slabs_.pop_front();
+        }
+    }
+    slabs_.push_front(merged);
+    return merged.data;
+}
+
+int SegmentedBuffer::fillIovec(struct iovec *iov, int maxIov) const
+{
+    int count = 0;
+    for (const Slab &slab : slabs_)
+    {
+        if (count == maxIov)
+        {
+            break;
+        }
+        if (slab.write > slab.read)
+        {
+            iov[count].iov_base = slab.data + slab.read;
+            iov[count].iov_len = slab.write - slab.read;
+            ++count;
+        }
+    }
+    return count;
+}
+
+ssize_t SegmentedBuffer::readFd(int fd, int *saveErrno, char *extrabuf, size_t extraLen)
+{
+    Slab &slab = writableSlab();
+    struct iovec vec[2];
+    const size_t writable = slab.capacity - slab.write;
+    vec[0].iov_base = slab.data + slab.write;
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extrabuf;
+    vec[1].iov_len = extraLen;
+
+    const ssize_t n = ::readv(fd, vec, extraLen > 0 ? 2 : 1);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+
+    const size_t len = static_cast<size_t>(n);
+    if (len <= writable)
+    {
+        slab.write += len;
+        readable_ += len;
+    }
+    else
+    {
+        slab.write = slab.capacity;
+        readable_ += writable;
+        append(extrabuf, len - writable); // 接到后面的新slab，已有数据不动
+    }
+    return n;
+}
+
+ssize_t SegmentedBuffer::writeFd(int fd, int *saveErrno) const
+{
+    struct iovec vec[kMaxWriteSegments];
+    int count = fillIovec(vec, kMaxWriteSegments);
+    ssize_t n = ::writev(fd, vec, count);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
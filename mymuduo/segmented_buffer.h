@@ -0,0 +1,80 @@
+#pragma once
+#include "noncopyable.h"
+#include <deque>
+#include <string>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/**
+ * @brief 分段缓冲区 由固定大小的slab串成链
+ * 追加只写尾部slab，写满了再接一个新的，已有数据不会因为扩容被拷贝或者挪动；
+ * 取走数据只移动头部slab的读位置，读完的slab摘下来（保留一个备用，避免反复分配）
+ * readv/writev直接跨多个slab读写
+ * 需要连续内存的解析代码用pullup把前len字节拼到一个slab里
+ *
+ * +--------------------+      +--------------------+      +--------------------+
+ * | 已读 | 可读         | ---> |       可读         | ---> | 可读 |   可写      |
+ * +--------------------+      +--------------------+      +--------------------+
+ *   front                                                   back
+ */
+class SegmentedBuffer : noncopyable
+{
+public:
+    static const size_t kDefaultSlabSize = 16 * 1024;
+    // 一次writev最多的分段数
+    static const int kMaxWriteSegments = 64;
+
+    explicit SegmentedBuffer(size_t slabSize = kDefaultSlabSize);
+    ~SegmentedBuffer();
+
+    void swap(SegmentedBuffer &rhs);
+
+    size_t readableBytes() const { return readable_; }
+    // 有数据的分段数
+    size_t segmentCount() const { return slabs_.size(); }
+
+    // 第一个分段的可读数据
+    const char *peek() const { return slabs_.empty() ? nullptr : slabs_.front().data + slabs_.front().read; }
+    size_t firstSegmentBytes() const { return slabs_.empty() ? 0 : slabs_.front().write - slabs_.front().read; }
+
+    /**
+     * @brief 把前len字节拼成连续内存，返回起始地址，len超过可读数据时返回nullptr
+     * 前len字节已经在第一个分段里时不拷贝
+     */
+    const char *pullup(size_t len);
+
+    void append(const char *data, size_t len);
+    void append(const std::string &str) { append(str.data(), str.size()); }
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAsString(size_t len);
+    std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
+
+    // 把可读数据填到iov里，最多maxIov个，返回填了几个
+    int fillIovec(struct iovec *iov, int maxIov) const;
+
+    // 读到尾部slab的剩余空间，放不下的先读到extrabuf再追加
+    ssize_t readFd(int fd, int *saveErrno, char *extrabuf, size_t extraLen);
+    // writev最多kMaxWriteSegments个分段，和Buffer::writeFd一样不取走数据
+    ssize_t writeFd(int fd, int *saveErrno) const;
+
+private:
+    struct Slab
+    {
+        char *data;
+        size_t capacity;
+        size_t read;
+        size_t write;
+    };
+
+    Slab newSlab(size_t capacity);
+    void freeSlab(const Slab &slab);
+    // 尾部slab的可写空间 没有或者写满了就接一个新的
+    Slab &writableSlab();
+
+    const size_t slabSize_;
+    std::deque<Slab> slabs_; // 只保存有数据的slab，最后一个可能还有可写空间
+    Slab spare_;             // 备用的空slab data为nullptr表示没有
+    size_t readable_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "string_piece.h"
+#include <memory>
+#include <string>
+
+/**
+ * @brief 引用计数的只读数据 拷贝SharedSlice只增加引用计数，不拷贝数据
+ * 一条消息发给很多连接时（聊天室、订阅推送）先做成一个SharedSlice，TcpConnection::send(SharedSlice)
+ * 没写完的部分在输出队列里只保存引用，直接从共享的存储writev出去
+ * 引用计数是原子的，可以在线程之间传递，数据构造之后不再修改
+ */
+class SharedSlice
+{
+public:
+    SharedSlice() : offset_(0), length_(0) {}
+    // 接管data，不拷贝
+    explicit SharedSlice(std::string &&data)
+        : storage_(std::make_shared<const std::string>(std::move(data))),
+          offset_(0),
+          length_(storage_->size())
+    {
+    }
+    // 拷贝一次
+    explicit SharedSlice(const StringPiece &data)
+        : storage_(std::make_shared<const std::string>(data.data(), data.size())),
+          offset_(0),
+          length_(data.size())
+    {
+    }
+    explicit SharedSlice(const char *str) : SharedSlice(StringPiece(str)) {}
+
+    const char *data() const { return storage_ ? storage_->data() + offset_ : nullptr; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    StringPiece toStringPiece() const { return StringPiece(data(), length_); }
+
+    // [offset, offset + len)的子区间，和原来的共享存储 超出范围的部分截掉
+    SharedSlice slice(size_t offset, size_t len) const
+    {
+        SharedSlice result(*this);
+        offset = offset < length_ ? offset : length_;
+        result.offset_ += offset;
+        result.length_ = len < length_ - offset ? len : length_ - offset;
+        return result;
+    }
+
+    // 共享这份存储的SharedSlice个数
+    long useCount() const { return storage_.use_count(); }
+
+private:
+    std::shared_ptr<const std::string> storage_;
+    size_t offset_;
+    size_t length_;
+};
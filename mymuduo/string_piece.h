@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+#include <stddef.h>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+ * @brief 不持有内存的字符串视图 只有指针和长度，拷贝不分配内存
+ * 指向的内存（比如Buffer的可读数据）变动之后视图失效，需要保存时用asString拷贝一份
+ * 用C++17编译时可以和std::string_view互相转换
+ */
+class StringPiece
+{
+public:
+    StringPiece() : ptr_(nullptr), length_(0) {}
+    StringPiece(const char *str) : ptr_(str), length_(str ? ::strlen(str) : 0) {}
+    StringPiece(const std::string &str) : ptr_(str.data()), length_(str.size()) {}
+    StringPiece(const char *data, size_t len) : ptr_(data), length_(len) {}
+#if __cplusplus >= 201703L
+    StringPiece(std::string_view view) : ptr_(view.data()), length_(view.size()) {}
+    operator std::string_view() const { return std::string_view(ptr_, length_); }
+#endif
+
+    const char *data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char *begin() const { return ptr_; }
+    const char *end() const { return ptr_ + length_; }
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    void removePrefix(size_t n)
+    {
+        ptr_ += n;
+        length_ -= n;
+    }
+    void removeSuffix(size_t n) { length_ -= n; }
+
+    bool startsWith(const StringPiece &prefix) const
+    {
+        return length_ >= prefix.length_ && ::memcmp(ptr_, prefix.ptr_, prefix.length_) == 0;
+    }
+
+    int compare(const StringPiece &rhs) const
+    {
+        int r = ::memcmp(ptr_, rhs.ptr_, length_ < rhs.length_ ? length_ : rhs.length_);
+        if (r == 0)
+        {
+            r = length_ < rhs.length_ ? -1 : (length_ > rhs.length_ ? 1 : 0);
+        }
+        return r;
+    }
+
+    bool operator==(const StringPiece &rhs) const
+    {
+        return length_ == rhs.length_ && ::memcmp(ptr_, rhs.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece &rhs) const { return !(*this == rhs); }
+    bool operator<(const StringPiece &rhs) const { return compare(rhs) < 0; }
+
+    std::string asString() const { return std::string(ptr_, length_); }
+
+private:
+    const char *ptr_;
+    size_t length_;
+};
@@ -4,13 +4,16 @@
 #include "channel.h"
 #include "eventloop.h"
 #include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <errno.h>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
     if (loop == nullptr)
     {
-        LOG_FATAL("%s:%d:%s CheckLoopNotNull loop==nullptr", __FILE__, __FUNCTION__, __LINE__);
+        LOG_FATAL("%s:%s:%d CheckLoopNotNull loop==nullptr", __FILE__, __FUNCTION__, __LINE__);
     }
     return loop;
 }
@@ -24,13 +27,26 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockf
       channel_(new Channel(loop, sockfd)),
       peeraddr_(localaddr),
       localaddr_(localaddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      idleTimeout_(0.0),
+      useSegmentedOutput_(false),
+      edgeTriggered_(false),
+      ioBudget_(kDefaultIoBudget),
+      completionIo_(false),
+      uring_(nullptr),
+      recvActive_(false),
+      sendsInFlight_(0),
+      sendBytesDone_(0),
+      sendErrno_(0)
 {
     // 下面给channel设置相应的回调函数，poller给channel通知感兴趣事件，channel调用回调函数
     channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
     channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
     channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
+    idleEntry_.setCallback(std::bind(&TcpConnection::handleIdleTimeout, this));
+    recvOp_.handler = std::bind(&TcpConnection::handleRecvComplete, this, std::placeholders::_1, std::placeholders::_2);
+    sendOp_.handler = std::bind(&TcpConnection::handleSendComplete, this, std::placeholders::_1, std::placeholders::_2);
 
     LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
     socket_->setKeepAlive(true);
@@ -42,19 +58,48 @@ TcpConnection::~TcpConnection()
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (state_ == kDisconnected)
+    {
+        return; // 边沿触发时排队的继续读取，连接已经关闭
+    }
+
+    // LT模式每次可读事件读一次；ET模式读到EAGAIN为止，超过ioBudget_时留到下一轮继续
     int saveErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &saveErrno); // LT模式
-    if (n > 0)
+    size_t total = 0;
+    ssize_t n;
+    do
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &saveErrno, loop_->extraBuffer(), loop_->extraBufferSize());
+        if (n > 0)
+        {
+            total += n;
+        }
+    } while (n > 0 && edgeTriggered_ && total < ioBudget_);
+
+    if (total > 0)
     {
+        touchIdleTimeout();
         // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作onMessage
         // shared_from_this 返回当前对象的智能指针
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
     }
+
+    if (n > 0)
+    {
+        // ET模式预算用完，可能还有数据但不会再有边沿通知
+        if (edgeTriggered_ && state_ != kDisconnected)
+        {
+            loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+        }
+    }
     else if (n == 0)
     {
-        handleClose();
+        if (state_ != kDisconnected)
+        {
+            handleClose();
+        }
     }
-    else
+    else if (!(edgeTriggered_ && (saveErrno == EAGAIN || saveErrno == EWOULDBLOCK)))
     {
         errno = saveErrno;
         LOG_ERROR("TcpConnection::handleRead");
@@ -64,17 +109,40 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 
 void TcpConnection::handleWrite()
 {
+    if (state_ == kDisconnected)
+    {
+        return; // 边沿触发时排队的继续写入，连接已经关闭
+    }
     // LT模式会一直上报fd可写 直至buffer写空时disableWriting
+    // ET模式EPOLLOUT一直注册着，buffer为空时的可写通知直接忽略
     if (channel_->isWriting()) // 是否可写
     {
+        if (edgeTriggered_ && outputBytes() == 0)
+        {
+            return;
+        }
+
         int saveErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &saveErrno);
-        if (n > 0)
+        size_t total = 0;
+        ssize_t n;
+        do
+        {
+            n = writeOutput(&saveErrno);
+            if (n > 0)
+            {
+                total += n;
+            }
+        } while (n > 0 && edgeTriggered_ && outputBytes() > 0 && total < ioBudget_);
+
+        if (total > 0)
         {
-            outputBuffer_.retrieve(n); // 复位
-            if (outputBuffer_.readableBytes() == 0)
+            touchIdleTimeout();
+            if (outputBytes() == 0)
             {
-                channel_->disableWriting();
+                if (!edgeTriggered_)
+                {
+                    channel_->disableWriting();
+                }
                 if (writeCompleteCallback_)
                 {
                     // 唤醒loop_对应的thread线程，执行回调
@@ -85,8 +153,13 @@ void TcpConnection::handleWrite()
                     shutdownInLoop();
                 }
             }
+            else if (edgeTriggered_ && n > 0)
+            {
+                // 预算用完，socket可能仍然可写，不会再有边沿通知
+                loop_->queueInLoop(std::bind(&TcpConnection::handleWrite, shared_from_this()));
+            }
         }
-        else
+        if (n <= 0 && !(edgeTriggered_ && (saveErrno == EAGAIN || saveErrno == EWOULDBLOCK)))
         {
             LOG_ERROR("TcpConnection::handleWrite");
         }
@@ -102,7 +175,16 @@ void TcpConnection::handleClose()
 {
     LOG_INFO("fd=%d state=%d \n", channel_->fd(), (int)state_);
     setState(kDisconnected);
-    channel_->disableAll();
+    // 完成式I/O下channel可能从来没有注册过，disableAll会把它以空事件注册到poller
+    if (!channel_->isNoneEvent())
+    {
+        channel_->disableAll();
+    }
+    cancelUringOps();
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // onConnection包含关闭连接的部分
@@ -125,66 +207,315 @@ void TcpConnection::handleError()
 // 发送数据：应用写的块，内核发送慢 需要将数据暂时缓存到缓冲区
 void TcpConnection::sendInLoop(const void *message, size_t len)
 {
-    ssize_t nwrote = 0;
-    size_t remaining = len;
-    bool faultError = false;
-
     // 之前调用过该connection的shutdown，不能发送
     if (state_ == kDisconnected)
     {
+        // connectDestroyde是urgent回调，可能先于之前排队的send执行，channel已经从poller删除，不能再写
         LOG_ERROR("TcpConnection::sendInLoop discoonected");
+        return;
     }
 
-    // 表示channel第一次开始写数据【此时还没有给channel注册EPOLLOUT事件】，而且缓冲区没有待发送的数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (uring_)
     {
-        nwrote = ::write(channel_->fd(), message, len);
-        if (nwrote >= 0)
+        size_t oldLen = outputBuffer_.readableBytes() + sendingBuffer_.readableBytes() - sendBytesDone_;
+        if (oldLen + len >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
         {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCallback_)
-            {
-                // 这里数据发送完成，就不用再给channel注册EPOLLOUT事件，就不会调用handleWrite方法
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-            }
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
         }
-        else // nwrote<0
+        outputBuffer_.append(static_cast<const char *>(message), len);
+        if (sendsInFlight_ == 0)
         {
-            nwrote = 0;
-            if (errno != EWOULDBLOCK) // 非阻塞正常的返回
-            {
-                LOG_ERROR("TcpConnection::sendInLoop");
-                if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE RESET
-                {
-                    faultError = true;
-                }
-            }
+            startSend();
         }
+        return;
     }
 
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(message);
+    iov.iov_len = len;
+    bool faultError = false;
+    size_t nwrote = writeDirect(&iov, 1, len, &faultError);
+
     // 说明当前write没有完全发送出去，剩余数据需要保存到缓冲区中，然后给channel
     // 注册epollout事件，poller发现tcp的发送缓冲区有空间，【LT模式不断】会通知相应的channel，调用writeCallback回调方法
     // 也就是调用TcpConnection::handleWrite方法，把发送缓冲的数据全部发送完成
-    if (!faultError && remaining > 0)
+    if (!faultError && nwrote < len)
+    {
+        size_t remaining = len - nwrote;
+        checkHighWaterMark(remaining);
+        appendOutput((char *)message + nwrote, remaining);
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting(); // 里面包含了注册事件
+        }
+    }
+}
+
+void TcpConnection::sendStringsInLoop(std::string &header, std::string &body)
+{
+    if (state_ == kDisconnected)
     {
-        // 目前缓冲区待发送的数据的长度
-        size_t oldLen = outputBuffer_.readableBytes();
+        LOG_ERROR("TcpConnection::sendStringsInLoop discoonected");
+        return;
+    }
 
-        // 已经超过高水位
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    if (uring_)
+    {
+        // 完成式I/O只有一个连续的outputBuffer_，拷贝
+        if (!header.empty())
         {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            sendInLoop(header.data(), header.size());
+        }
+        if (!body.empty())
+        {
+            sendInLoop(body.data(), body.size());
+        }
+        return;
+    }
+
+    struct iovec iov[2];
+    int count = 0;
+    if (!header.empty())
+    {
+        iov[count].iov_base = &header[0];
+        iov[count].iov_len = header.size();
+        ++count;
+    }
+    if (!body.empty())
+    {
+        iov[count].iov_base = &body[0];
+        iov[count].iov_len = body.size();
+        ++count;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    size_t len = header.size() + body.size();
+    bool faultError = false;
+    size_t nwrote = writeDirect(iov, count, len, &faultError);
+    if (!faultError && nwrote < len)
+    {
+        checkHighWaterMark(len - nwrote);
+        if (nwrote < header.size())
+        {
+            appendOutput(std::move(header), nwrote);
+            appendOutput(std::move(body), 0);
+        }
+        else
+        {
+            appendOutput(std::move(body), nwrote - header.size());
         }
-        outputBuffer_.append((char *)message + nwrote, remaining);
         if (!channel_->isWriting())
         {
-            channel_->enableWriting(); // 里面包含了注册事件
+            channel_->enableWriting();
+        }
+    }
+}
+
+void TcpConnection::sendBufferInLoop(Buffer *buf)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("TcpConnection::sendBufferInLoop discoonected");
+        return;
+    }
+
+    size_t len = buf->readableBytes();
+    if (uring_)
+    {
+        // 完成式I/O只有一个连续的outputBuffer_，拷贝
+        sendInLoop(buf->peek(), len);
+        buf->retrieveAll();
+        return;
+    }
+    if (len == 0)
+    {
+        return;
+    }
+
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(buf->peek());
+    iov.iov_len = len;
+    bool faultError = false;
+    size_t nwrote = writeDirect(&iov, 1, len, &faultError);
+    buf->retrieve(nwrote);
+    if (!faultError && nwrote < len)
+    {
+        checkHighWaterMark(len - nwrote);
+        appendOutput(buf);
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+    }
+    buf->retrieveAll(); // 对端已经关闭时丢弃
+}
+
+void TcpConnection::sendSliceInLoop(const SharedSlice &slice)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("TcpConnection::sendSliceInLoop discoonected");
+        return;
+    }
+
+    size_t len = slice.size();
+    if (uring_)
+    {
+        // 完成式I/O只有一个连续的outputBuffer_，拷贝
+        sendInLoop(slice.data(), len);
+        return;
+    }
+    if (len == 0)
+    {
+        return;
+    }
+
+    struct iovec iov;
+    iov.iov_base = const_cast<char *>(slice.data());
+    iov.iov_len = len;
+    bool faultError = false;
+    size_t nwrote = writeDirect(&iov, 1, len, &faultError);
+    if (!faultError && nwrote < len)
+    {
+        checkHighWaterMark(len - nwrote);
+        appendOutput(slice, nwrote);
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+    }
+}
+
+size_t TcpConnection::writeDirect(const struct iovec *iov, int count, size_t len, bool *faultError)
+{
+    // 表示channel第一次开始写数据【此时还没有给channel注册EPOLLOUT事件】，而且缓冲区没有待发送的数据
+    // ET模式EPOLLOUT一直注册着，只看缓冲区
+    if ((!edgeTriggered_ && channel_->isWriting()) || outputBytes() > 0)
+    {
+        return 0;
+    }
+
+    ssize_t nwrote = count == 1 ? ::write(channel_->fd(), iov[0].iov_base, iov[0].iov_len)
+                                : ::writev(channel_->fd(), iov, count);
+    if (nwrote >= 0)
+    {
+        if (static_cast<size_t>(nwrote) == len && writeCompleteCallback_)
+        {
+            // 这里数据发送完成，就不用再给channel注册EPOLLOUT事件，就不会调用handleWrite方法
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        return nwrote;
+    }
+
+    if (errno != EWOULDBLOCK) // 非阻塞正常的返回
+    {
+        LOG_ERROR("TcpConnection::sendInLoop");
+        if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE RESET
+        {
+            *faultError = true;
         }
     }
+    return 0;
+}
+
+void TcpConnection::checkHighWaterMark(size_t remaining)
+{
+    // 目前缓冲区待发送的数据的长度
+    size_t oldLen = outputBytes();
+
+    // 已经超过高水位
+    if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+    }
 }
+
+void TcpConnection::appendOutput(const char *data, size_t len)
+{
+    if (useSegmentedOutput_)
+    {
+        segmentedOutput_.append(data, len);
+    }
+    else
+    {
+        outputQueue_.append(data, len);
+    }
+}
+
+void TcpConnection::appendOutput(Buffer *buf)
+{
+    if (useSegmentedOutput_)
+    {
+        segmentedOutput_.append(buf->peek(), buf->readableBytes());
+        buf->retrieveAll();
+    }
+    else
+    {
+        outputQueue_.append(buf);
+    }
+}
+
+void TcpConnection::appendOutput(std::string &&data, size_t offset)
+{
+    if (useSegmentedOutput_)
+    {
+        segmentedOutput_.append(data.data() + offset, data.size() - offset);
+    }
+    else
+    {
+        outputQueue_.append(std::move(data), offset);
+    }
+}
+
+void TcpConnection::appendOutput(const SharedSlice &slice, size_t offset)
+{
+    if (useSegmentedOutput_)
+    {
+        segmentedOutput_.append(slice.data() + offset, slice.size() - offset);
+    }
+    else
+    {
+        outputQueue_.append(slice, offset);
+    }
+}
+
+ssize_t TcpConnection::writeOutput(int *saveErrno)
+{
+    ssize_t n;
+    if (useSegmentedOutput_)
+    {
+        n = segmentedOutput_.writeFd(channel_->fd(), saveErrno);
+        if (n > 0)
+        {
+            segmentedOutput_.retrieve(n);
+        }
+    }
+    else
+    {
+        n = outputQueue_.writeFd(channel_->fd(), saveErrno);
+        if (n > 0)
+        {
+            outputQueue_.retrieve(n); // 复位
+        }
+    }
+    return n;
+}
+
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting())
+    bool writing;
+    if (uring_)
+    {
+        writing = sendsInFlight_ > 0;
+    }
+    else
+    {
+        writing = edgeTriggered_ ? outputBytes() > 0 : channel_->isWriting();
+    }
+    if (!writing)
     {
         // 说明当前outputBuffer的数据已经全部完成
         socket_->shutdownWrite(); // 关闭写端，触发EPOLLHUP
@@ -197,21 +528,139 @@ void TcpConnection::shutdown()
     if (state_ == kConnected)
     {
         setState(kDisconnecting);
-        loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, this));
+        // 必须和send同为bulk优先级，保证排在之前的send后面执行
+        // 持有连接的引用：urgent的connectDestroyde可能先执行，释放掉最后一个TcpConnectionPtr
+        loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
     }
 }
 
 void TcpConnection::send(const std::string &buf)
+{
+    // 跨线程时拷贝一份，buf在回调执行时可能已经失效
+    send(buf.data(), buf.size());
+}
+
+// 跨线程send的回调都持有连接的引用，urgent的connectDestroyde可能排在它们前面执行
+struct TcpConnection::SendStringTask
+{
+    void operator()()
+    {
+        std::string header;
+        conn->sendStringsInLoop(header, message);
+    }
+
+    TcpConnectionPtr conn;
+    std::string message;
+};
+
+struct TcpConnection::SendHeaderBodyTask
+{
+    void operator()() { conn->sendStringsInLoop(parts->first, parts->second); }
+
+    TcpConnectionPtr conn;
+    // 两个string放不进回调的内联存储，放到堆上
+    std::unique_ptr<std::pair<std::string, std::string>> parts;
+};
+
+struct TcpConnection::SendBufferTask
+{
+    void operator()() { conn->sendBufferInLoop(buffer.get()); }
+
+    TcpConnectionPtr conn;
+    std::unique_ptr<Buffer> buffer;
+};
+
+struct TcpConnection::SendSliceTask
+{
+    void operator()() { conn->sendSliceInLoop(slice); }
+
+    TcpConnectionPtr conn;
+    SharedSlice slice;
+};
+
+void TcpConnection::send(const void *data, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(data, len);
+        }
+        else
+        {
+            // data在回调执行时可能已经失效
+            SendStringTask task = {shared_from_this(), std::string(static_cast<const char *>(data), len)};
+            loop_->runInLoop(std::move(task));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendBufferInLoop(buf);
+        }
+        else
+        {
+            // 和buf用同一个池交换，buf保留原来的池；池只能在调用线程用，转交前换到堆上（池里的块很小，拷贝一次）
+            SendBufferTask task = {shared_from_this(), std::unique_ptr<Buffer>(new Buffer(Buffer::kInitialSize, buf->pool()))};
+            task.buffer->swap(*buf);
+            task.buffer->setPool(nullptr);
+            loop_->runInLoop(std::move(task));
+        }
+    }
+}
+
+void TcpConnection::send(const SharedSlice &slice)
 {
     if (state_ == kConnected)
     {
         if (loop_->isInLoopThread())
         {
-            sendInLoop(buf.c_str(), buf.size());
+            sendSliceInLoop(slice);
         }
         else
         {
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            // 只增加引用计数
+            SendSliceTask task = {shared_from_this(), slice};
+            loop_->runInLoop(std::move(task));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            std::string header;
+            sendStringsInLoop(header, message);
+        }
+        else
+        {
+            SendStringTask task = {shared_from_this(), std::move(message)};
+            loop_->runInLoop(std::move(task));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&header, std::string &&body)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringsInLoop(header, body);
+        }
+        else
+        {
+            SendHeaderBodyTask task = {shared_from_this(), std::unique_ptr<std::pair<std::string, std::string>>(
+                                                 new std::pair<std::string, std::string>(std::move(header), std::move(body)))};
+            loop_->runInLoop(std::move(task));
         }
     }
 }
@@ -221,8 +670,30 @@ void TcpConnection::connectEstablished()
 {
     setState(kConnected);
     channel_->tie(shared_from_this());
-    // 开始只对读感兴趣
-    channel_->enableReading();
+    uring_ = completionIo_ ? loop_->ioUringPoller() : nullptr;
+    if (uring_)
+    {
+        useSegmentedOutput_ = false; // submitSend只接受连续内存
+    }
+    // 连接在mainLoop中构造，池属于这个loop，到loop线程里才设置
+    inputBuffer_.setPool(loop_->bufferPool());
+    if (!uring_)
+    {
+        // 完成式I/O的outputBuffer_会换给sendingBuffer_交给内核，不用池
+        outputQueue_.setPool(loop_->bufferPool());
+    }
+    if (!uring_ || !startRecv())
+    {
+        if (edgeTriggered_ && !uring_)
+        {
+            // 读写事件一次注册，之后不再修改
+            channel_->setEdgeTriggered(true);
+            channel_->enableWriting();
+        }
+        // 开始只对读感兴趣
+        channel_->enableReading();
+    }
+    touchIdleTimeout();
 
     // 新连接建立。执行回调
     connectionCallback_(shared_from_this());
@@ -234,8 +705,234 @@ void TcpConnection::connectDestroyde()
     if (state_ == kConnected)
     {
         setState(kDisconnected);
-        channel_->disableAll(); // 把channel_感兴趣的事件全部del
+        if (!channel_->isNoneEvent())
+        {
+            channel_->disableAll(); // 把channel_感兴趣的事件全部del
+        }
+        cancelUringOps();
         connectionCallback_(shared_from_this());
     }
+    if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
+    // TcpConnection可能在别的线程析构（用户持有TcpConnectionPtr），池里的块在这里还回去
+    inputBuffer_.setPool(nullptr);
+    outputQueue_.setPool(nullptr);
     channel_->remove(); // 把channel从Poller中删除
-}
\ No newline at end of file
+}
+
+void TcpConnection::setIdleTimeout(double seconds)
+{
+    if (loop_->isInLoopThread())
+    {
+        setIdleTimeoutInLoop(seconds);
+    }
+    else
+    {
+        loop_->queueInLoop(std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds), EventLoop::kUrgent);
+    }
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds)
+{
+    idleTimeout_ = seconds;
+    if (idleTimeout_ > 0.0)
+    {
+        touchIdleTimeout();
+    }
+    else if (idleEntry_.linked())
+    {
+        loop_->timingWheel()->remove(&idleEntry_);
+    }
+}
+
+void TcpConnection::touchIdleTimeout()
+{
+    // 连接建立前设置的超时在connectEstablished中生效
+    if (idleTimeout_ > 0.0 && (state_ == kConnected || state_ == kDisconnecting))
+    {
+        loop_->timingWheel()->add(&idleEntry_, idleTimeout_);
+    }
+}
+
+void TcpConnection::handleIdleTimeout()
+{
+    LOG_INFO("TcpConnection::handleIdleTimeout [%s] idle for %.1f seconds\n", name_.c_str(), idleTimeout_);
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+bool TcpConnection::startRecv()
+{
+    if (!uring_->submitRecvMultishot(channel_->fd(), &recvOp_))
+    {
+        return false;
+    }
+    recvActive_ = true;
+    if (!uringSelf_)
+    {
+        uringSelf_ = shared_from_this();
+    }
+    return true;
+}
+
+void TcpConnection::startSend()
+{
+    // sendingBuffer_为空时把outputBuffer_整个换过去，之后的send继续追加到outputBuffer_
+    if (sendingBuffer_.readableBytes() == 0)
+    {
+        sendingBuffer_.swap(outputBuffer_);
+    }
+    sendBytesDone_ = 0;
+    sendErrno_ = 0;
+    sendsInFlight_ = uring_->submitSend(channel_->fd(), sendingBuffer_.peek(), sendingBuffer_.readableBytes(), &sendOp_);
+    if (!uringSelf_)
+    {
+        uringSelf_ = shared_from_this();
+    }
+}
+
+void TcpConnection::handleRecvComplete(int res, uint32_t flags)
+{
+    if (!IoUringPoller::hasMore(flags))
+    {
+        recvActive_ = false;
+    }
+
+    if (res > 0)
+    {
+        inputBuffer_.append(uring_->recvBuffer(flags), res);
+        uring_->recycleRecvBuffer(flags);
+        if (state_ == kConnected || state_ == kDisconnecting)
+        {
+            touchIdleTimeout();
+            messageCallback_(shared_from_this(), &inputBuffer_, Timestamp::now());
+        }
+        // 内核结束了multishot（比如CQ溢出），重新提交
+        if (!recvActive_ && (state_ == kConnected || state_ == kDisconnecting))
+        {
+            startRecv();
+        }
+    }
+    else if (res == 0)
+    {
+        if (state_ == kConnected || state_ == kDisconnecting)
+        {
+            handleClose();
+        }
+    }
+    else if (res == -ENOBUFS)
+    {
+        // provided buffer用完了，本批完成事件中的缓冲区都已经归还，重新提交即可
+        if (!recvActive_ && (state_ == kConnected || state_ == kDisconnecting))
+        {
+            startRecv();
+        }
+    }
+    else if (res == -EINVAL && !recvActive_)
+    {
+        // 内核不支持multishot recv，这个loop退回就绪通知+read
+        LOG_ERROR("TcpConnection::handleRecvComplete multishot recv unsupported, fall back to readv\n");
+        uring_->disableRecvMultishot();
+        if (state_ == kConnected || state_ == kDisconnecting)
+        {
+            channel_->enableReading();
+        }
+    }
+    else if (res != -ECANCELED)
+    {
+        errno = -res;
+        LOG_ERROR("TcpConnection::handleRecvComplete errno:%d\n", -res);
+        handleError();
+        if (state_ == kConnected || state_ == kDisconnecting)
+        {
+            handleClose();
+        }
+    }
+    releaseUringSelf();
+}
+
+void TcpConnection::handleSendComplete(int res, uint32_t /*flags*/)
+{
+    --sendsInFlight_;
+    if (res > 0)
+    {
+        sendBytesDone_ += res;
+    }
+    else if (res < 0 && res != -ECANCELED && sendErrno_ == 0)
+    {
+        // 前面的请求没发完（出错时）导致链上后面的请求以-ECANCELED完成，不算错误，剩下的数据重新提交
+        sendErrno_ = -res;
+    }
+    if (sendsInFlight_ > 0)
+    {
+        return;
+    }
+
+    // 这一批全部完成，才能修改sendingBuffer_
+    sendingBuffer_.retrieve(sendBytesDone_);
+    if (state_ == kDisconnected)
+    {
+        sendingBuffer_.retrieveAll();
+        releaseUringSelf();
+        return;
+    }
+    if (sendErrno_ != 0)
+    {
+        LOG_ERROR("TcpConnection::handleSendComplete errno:%d\n", sendErrno_);
+        // 和就绪模式一样，连接的关闭由读端的完成事件处理
+        sendingBuffer_.retrieveAll();
+        outputBuffer_.retrieveAll();
+        releaseUringSelf();
+        return;
+    }
+
+    if (sendBytesDone_ > 0)
+    {
+        touchIdleTimeout();
+    }
+    if (sendingBuffer_.readableBytes() > 0 || outputBuffer_.readableBytes() > 0)
+    {
+        startSend();
+    }
+    else
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+        releaseUringSelf();
+    }
+}
+
+void TcpConnection::cancelUringOps()
+{
+    if (!uring_)
+    {
+        return;
+    }
+    if (recvActive_)
+    {
+        uring_->submitCancel(&recvOp_);
+    }
+    if (sendsInFlight_ > 0)
+    {
+        uring_->submitCancel(&sendOp_);
+    }
+}
+
+void TcpConnection::releaseUringSelf()
+{
+    if (!recvActive_ && sendsInFlight_ == 0 && uringSelf_)
+    {
+        // 可能是最后一个引用，reset之后不能再访问成员
+        TcpConnectionPtr self;
+        self.swap(uringSelf_);
+    }
+}
@@ -6,7 +6,12 @@
 #include <string>
 #include <atomic>
 #include "buffer.h"
+#include "segmented_buffer.h"
+#include "output_queue.h"
+#include "shared_slice.h"
 #include "timestamp.h"
+#include "timing_wheel.h"
+#include "io_uring_poller.h"
 
 class Channel;
 class EventLoop;
@@ -19,6 +24,8 @@ class Socket;
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    static const size_t kDefaultIoBudget = 256 * 1024;
+
     TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localaddr, const InetAddress &peeraddr);
     ~TcpConnection();
 
@@ -29,8 +36,20 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
-    // 发送数据
+    // 发送数据 没有一次写完的部分拷贝进输出缓冲区
     void send(const std::string &buf);
+    // 移交message，没有一次写完的部分整块挂到输出队列上，不拷贝
+    void send(std::string &&message);
+    // 头部和正文用一次writev发出去，都不拷贝，适合HTTP这类头部+大正文的响应
+    void send(std::string &&header, std::string &&body);
+    // 发送视图之类的裸数据，没写完的部分拷贝，跨线程时先拷贝一份
+    void send(const void *data, size_t len);
+    // 发送buf的全部可读数据并取走，没写完的部分把buf的存储整块换进输出队列，不拷贝
+    // 跨线程时存储随回调转交给连接所在的loop
+    void send(Buffer *buf);
+    // 发送共享的数据，没写完的部分在输出队列里只保存引用，不拷贝
+    // 一条消息发给很多连接时先做成一个SharedSlice，每个连接send同一个，只占一份内存
+    void send(const SharedSlice &slice);
     // 关闭连接
     void shutdown();
 
@@ -60,6 +79,35 @@ public:
         highWaterMark_ = highWaterMark;
     }
 
+    /**
+     * @brief 设置空闲超时 seconds秒内没有读写就关闭连接，<=0表示不检测
+     * 每次handleRead/handleWrite刷新，基于loop的时间轮O(1)实现
+     */
+    void setIdleTimeout(double seconds);
+
+    /**
+     * @brief 所在loop使用io_uring时，用完成式I/O代替就绪通知+read/write
+     * 读：multishot recv到loop共享的provided buffer ring，再拷贝进inputBuffer_
+     * 写：outputBuffer_换到sendingBuffer_后用链接的send提交，完成之前不再修改
+     * MessageCallback等回调语义不变，connectEstablished之前设置，epoll loop上忽略
+     */
+    void setCompletionIo(bool on) { completionIo_ = on; }
+
+    /**
+     * @brief 边沿触发模式 EPOLLOUT一直注册着，输出缓冲区清空时不再disableWriting/enableWriting
+     * handleRead/handleWrite一直读写到EAGAIN，单次最多ioBudget字节，超出的排到下一轮继续，避免一个连接饿死其他连接
+     * connectEstablished之前设置
+     */
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    void setIoBudget(size_t bytes) { ioBudget_ = bytes; }
+
+    /**
+     * @brief 输出缓冲区使用SegmentedBuffer 所有数据都拷贝进固定大小的slab，用writev跨分段发送
+     * 适合大量小块send积压的连接，send(std::string&&)也会拷贝，connectEstablished之前设置
+     * 完成式I/O的send需要连续内存，这时忽略这个选项
+     */
+    void setSegmentedOutput(bool on) { useSegmentedOutput_ = on; }
+
     // 连接建立
     void connectEstablished();
     // 连接销毁
@@ -71,9 +119,54 @@ private:
     void handleClose();
     void handleError();
     void sendInLoop(const void *message, size_t len);
+    // header和body发送完或者移交给输出队列之后变空
+    void sendStringsInLoop(std::string &header, std::string &body);
+    // 跨线程send(std::string&&)的回调 C++11的lambda不能移动捕获
+    struct SendStringTask;
+    struct SendHeaderBodyTask;
+    struct SendBufferTask;
+    struct SendSliceTask;
+    // 发送后buf变空
+    void sendBufferInLoop(Buffer *buf);
+    void sendSliceInLoop(const SharedSlice &slice);
+
+    // 输出队列为空时直接写fd，返回写出去的字节数，对端已经关闭时设置faultError
+    size_t writeDirect(const struct iovec *iov, int count, size_t len, bool *faultError);
+    // 没写完的remaining字节进入输出队列之前检查高水位
+    void checkHighWaterMark(size_t remaining);
+
+    // 就绪通知模式下的输出队列 根据useSegmentedOutput_选择OutputQueue或者SegmentedBuffer
+    size_t outputBytes() const
+    {
+        return useSegmentedOutput_ ? segmentedOutput_.readableBytes() : outputQueue_.readableBytes();
+    }
+    void appendOutput(const char *data, size_t len);
+    // 从offset开始的部分排队 OutputQueue不拷贝，SegmentedBuffer拷贝
+    void appendOutput(std::string &&data, size_t offset);
+    // 取走buf的全部数据 OutputQueue交换存储，SegmentedBuffer拷贝
+    void appendOutput(Buffer *buf);
+    // 从offset开始的部分排队 OutputQueue保存引用，SegmentedBuffer拷贝
+    void appendOutput(const SharedSlice &slice, size_t offset);
+    // 写fd并取走写出去的数据
+    ssize_t writeOutput(int *saveErrno);
 
     void shutdownInLoop();
 
+    void setIdleTimeoutInLoop(double seconds);
+    // 刷新空闲超时
+    void touchIdleTimeout();
+    // 空闲超时，走handleClose关闭连接
+    void handleIdleTimeout();
+
+    // 完成式I/O
+    bool startRecv();
+    void startSend();
+    void handleRecvComplete(int res, uint32_t flags);
+    void handleSendComplete(int res, uint32_t flags);
+    void cancelUringOps();
+    // 请求全部完成后释放uringSelf_
+    void releaseUringSelf();
+
     enum State
     {
         kDisconnected,
@@ -103,6 +196,27 @@ private:
     HighWaterMarkCallback highWaterMarkCallback_;
 
     size_t highWaterMark_;
+
+    double idleTimeout_;
+    TimingWheel::Entry idleEntry_; // 析构时自动从时间轮摘除
     Buffer inputBuffer_;  // 读fd
-    Buffer outputBuffer_; // 写fd
+    Buffer outputBuffer_;     // 完成式I/O的输出缓冲区
+    OutputQueue outputQueue_; // 写fd
+    bool useSegmentedOutput_;
+    SegmentedBuffer segmentedOutput_; // useSegmentedOutput_时代替outputQueue_
+
+    bool edgeTriggered_;
+    size_t ioBudget_; // 边沿触发时一次读/写的最大字节数
+
+    bool completionIo_;
+    IoUringPoller *uring_; // 非空表示使用完成式I/O
+    IoUringPoller::Operation recvOp_;
+    IoUringPoller::Operation sendOp_;
+    bool recvActive_;      // multishot recv还没有结束
+    int sendsInFlight_;    // 还没有完成的send请求数
+    size_t sendBytesDone_; // 本批send已经发送的字节数
+    int sendErrno_;
+    Buffer sendingBuffer_; // 内核正在发送的数据，请求完成之前不能修改
+    // 有请求未完成时持有自己，保证Operation在完成事件到达之前有效
+    std::shared_ptr<TcpConnection> uringSelf_;
 };
\ No newline at end of file
@@ -8,7 +8,7 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
     if (loop == nullptr)
     {
-        LOG_FATAL("%s:%d:%s CheckLoopNotNull loop==nullptr", __FILE__, __FUNCTION__, __LINE__);
+        LOG_FATAL("%s:%s:%d CheckLoopNotNull loop==nullptr", __FILE__, __FUNCTION__, __LINE__);
     }
     return loop;
 }
@@ -22,7 +22,11 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenaddr, const std::
       connectionCallback_(),
       messageCallback_(),
       nextConnId_(),
-      started_(0)
+      started_(0),
+      completionIo_(false),
+      edgeTriggered_(false),
+      ioBudget_(TcpConnection::kDefaultIoBudget),
+      segmentedOutput_(false)
 {
     // 给listenfd注册回调，当有新用户连接受调用回调
     acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
@@ -33,7 +37,7 @@ TcpServer::~TcpServer()
     {
         TcpConnectionPtr conn(item.second); // conn局部智能指针对象，出右括号自动释放new出来的TcpConnection资源
         item.second.reset();
-        conn->getloop()->runInLoop(std::bind(&TcpConnection::connectDestroyde, conn));
+        conn->getloop()->runInLoop(std::bind(&TcpConnection::connectDestroyde, conn), EventLoop::kUrgent);
     }
 }
 
@@ -43,6 +47,16 @@ void TcpServer::setThreadNum(int numThreads)
     threadpool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setBusyPoll(int maxSpinUs)
+{
+    threadpool_->setBusyPoll(maxSpinUs);
+}
+
+void TcpServer::setPollerType(EventLoop::PollerType type)
+{
+    threadpool_->setPollerType(type);
+}
+
 // 开启服务器监听
 void TcpServer::start()
 {
@@ -57,7 +71,7 @@ void TcpServer::start()
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn), EventLoop::kUrgent);
 }
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 {
@@ -65,7 +79,7 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 
     connections_.erase(conn->name());
     EventLoop *ioLoop = conn->getloop();
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyde, conn));
+    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyde, conn), EventLoop::kUrgent);
 }
 
 /**
@@ -107,10 +121,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCompletionIo(completionIo_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setIoBudget(ioBudget_);
+    conn->setSegmentedOutput(segmentedOutput_);
 
     // 设置如何关闭连接 conn->shutdown
     conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
 
     // 直接调用TcpConnection::connectEstalished
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn), EventLoop::kUrgent);
 }
\ No newline at end of file
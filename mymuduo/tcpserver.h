@@ -34,6 +34,17 @@ public:
 
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
+    // 设置subloop的忙轮询时间（微秒），mainloop保持阻塞，start之前调用
+    void setBusyPoll(int maxSpinUs);
+    // 设置subloop使用的Poller，mainloop由使用者自己构造，start之前调用
+    void setPollerType(EventLoop::PollerType type);
+    // 连接在io_uring loop上使用完成式I/O，见TcpConnection::setCompletionIo
+    void setCompletionIo(bool on) { completionIo_ = on; }
+    // 连接使用边沿触发，见TcpConnection::setEdgeTriggered
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    void setIoBudget(size_t bytes) { ioBudget_ = bytes; }
+    // 连接的输出缓冲区使用SegmentedBuffer，见TcpConnection::setSegmentedOutput
+    void setSegmentedOutput(bool on) { segmentedOutput_ = on; }
 
     // 开启服务器监听
     void start();
@@ -60,5 +71,9 @@ private:
 
     std::atomic_int started_;
     int nextConnId_;
+    bool completionIo_;
+    bool edgeTriggered_;
+    size_t ioBudget_;
+    bool segmentedOutput_;
     ConnectionMap connections_; // 保存所有的连接
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "timestamp.h"
+#include "callbacks.h"
+#include <atomic>
+
+/**
+ * @brief 定时器 封装超时回调、超时时间点以及重复间隔
+ *
+ */
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++numCreated_)
+    {
+    }
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器重新计算下一次超时时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return numCreated_; }
+
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_; // 超时时间点
+    const double interval_; // 重复间隔 秒
+    const bool repeat_;
+    const int64_t sequence_; // 全局唯一序号 区分地址被复用的Timer
+
+    static std::atomic<int64_t> numCreated_;
+};
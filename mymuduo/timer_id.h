@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * @brief 定时器句柄 用于EventLoop::cancel取消定时器
+ * 只保存Timer指针和序号，不负责Timer的生命周期
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr),
+          sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer),
+          sequence_(seq)
+    {
+    }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
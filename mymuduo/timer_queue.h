@@ -0,0 +1,67 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "timestamp.h"
+#include "callbacks.h"
+#include "channel.h"
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * @brief 定时器队列 每个EventLoop一个timerfd，始终设置为最早的超时时间
+ * 超时后timerfd可读，由wakeup同样的方式在loop线程中处理到期的定时器
+ * 超时时间点都是单调时钟（Timestamp::monotonic），系统改时间不影响定时器
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    /**
+     * @brief 添加定时器 线程安全，其他线程调用会通过queueInLoop转到loop线程
+     *
+     * @param cb 超时回调
+     * @param when 超时时间点 单调时钟
+     * @param interval 大于0表示重复定时器的间隔（秒）
+     * @return TimerId
+     */
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer *>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer *, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd可读时调用
+    void handleRead();
+
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复定时器重新插入，并重新设置timerfd
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+
+    // 返回插入的定时器是否成为最早到期的定时器
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList timers_; // 按超时时间排序
+
+    // 按Timer地址排序，和timers_保存相同的定时器，用于cancel
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_; // 在回调中被取消的定时器
+};
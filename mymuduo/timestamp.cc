@@ -1,6 +1,13 @@
 #include "timestamp.h"
 #include <time.h>
 
+static int64_t readClock(clockid_t clock)
+{
+    struct timespec ts;
+    ::clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
 Timestamp::Timestamp() : microSecondsSinceEpoch_(0)
 {
 }
@@ -14,13 +21,37 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch) : microSecondsSinceEpoch_(m
 ///
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    // clock_gettime走vDSO，不陷入内核
+    return Timestamp(readClock(CLOCK_REALTIME));
+}
+
+Timestamp Timestamp::nowCoarse()
+{
+    return Timestamp(readClock(CLOCK_REALTIME_COARSE));
+}
+
+Timestamp Timestamp::monotonic()
+{
+    return Timestamp(readClock(CLOCK_MONOTONIC));
+}
+
+Timestamp Timestamp::monotonicCoarse()
+{
+    return Timestamp(readClock(CLOCK_MONOTONIC_COARSE));
+}
+
+int64_t Timestamp::monotonicNanos()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
 }
 
 std::string Timestamp::toString() const
 {
     char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    tm *tm_time = localtime(&seconds);
     snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
              tm_time->tm_year + 1900, tm_time->tm_mon + 1,
              tm_time->tm_mday, tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec);
@@ -1,8 +1,14 @@
 #pragma once
-#pragma once
 #include <iostream>
 #include <string>
+#include <stdint.h>
 
+/**
+ * @brief 微秒精度的时间点
+ * now()/nowCoarse()是墙上时间（自1970年），用于日志和toString
+ * monotonic()/monotonicCoarse()是单调时钟（自开机），不受系统改时间影响，只能用来算时间间隔，定时器使用
+ * 两种时间点不能互相比较
+ */
 class Timestamp
 {
 public:
@@ -15,9 +21,46 @@ public:
     /// Get time of now.
     ///
     static Timestamp now();
+    // CLOCK_REALTIME_COARSE 精度是一个时钟节拍（通常1~4ms），开销更小
+    static Timestamp nowCoarse();
+    // 单调时钟
+    static Timestamp monotonic();
+    static Timestamp monotonicCoarse();
+    // 纳秒精度的单调时钟，测量短延迟使用
+    static int64_t monotonicNanos();
+    static Timestamp invalid() { return Timestamp(); }
 
     std::string toString() const;
 
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
 private:
     int64_t microSecondsSinceEpoch_ = 0;
 };
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// high - low 秒
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 给定时间点加上seconds秒，定时器计算下一次超时时间使用
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,251 @@
+#include "timing_wheel.h"
+#include "eventloop.h"
+#include "timestamp.h"
+#include <math.h>
+
+constexpr double TimingWheel::kDefaultTickSeconds;
+
+static void initList(TimingWheel::Node *head)
+{
+    head->prev = head->next = head;
+}
+
+static void listAddTail(TimingWheel::Node *head, TimingWheel::Node *node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void listDel(TimingWheel::Node *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+// 把from链表整体转移到to（to必须为空）
+static void listSplice(TimingWheel::Node *from, TimingWheel::Node *to)
+{
+    if (from->next == from)
+    {
+        initList(to);
+        return;
+    }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    initList(from);
+}
+
+TimingWheel::Entry::~Entry()
+{
+    if (wheel_)
+    {
+        wheel_->remove(this);
+    }
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds)
+    : loop_(loop),
+      tickSeconds_(tickSeconds),
+      startTime_(Timestamp::monotonic().microSecondsSinceEpoch()),
+      current_(0),
+      size_(0),
+      timerRunning_(false)
+{
+    for (int i = 0; i < kRootSize; i++)
+    {
+        initList(&root_[i]);
+    }
+    for (int level = 0; level < kLevels; level++)
+    {
+        for (int i = 0; i < kLevelSize; i++)
+        {
+            initList(&levels_[level][i]);
+        }
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+    stopTimer();
+    // 还在时间轮里的entry只摘链，不执行回调
+    for (int i = 0; i < kRootSize; i++)
+    {
+        while (root_[i].next != &root_[i])
+        {
+            unlink(static_cast<Entry *>(root_[i].next));
+        }
+    }
+    for (int level = 0; level < kLevels; level++)
+    {
+        for (int i = 0; i < kLevelSize; i++)
+        {
+            Node *head = &levels_[level][i];
+            while (head->next != head)
+            {
+                unlink(static_cast<Entry *>(head->next));
+            }
+        }
+    }
+}
+
+void TimingWheel::add(Entry *entry, double timeout)
+{
+    if (entry->wheel_)
+    {
+        // 刷新：从原来的槽摘下来，O(1)
+        listDel(entry);
+    }
+    else
+    {
+        entry->wheel_ = this;
+        ++size_;
+    }
+
+    uint64_t ticks = static_cast<uint64_t>(ceil(timeout / tickSeconds_));
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+    else if (ticks > kMaxTicks)
+    {
+        ticks = kMaxTicks;
+    }
+    if (!timerRunning_)
+    {
+        startTimer();
+    }
+    entry->expire_ = current_ + ticks;
+    place(entry);
+}
+
+void TimingWheel::remove(Entry *entry)
+{
+    if (entry->wheel_ == this)
+    {
+        unlink(entry);
+    }
+}
+
+void TimingWheel::unlink(Entry *entry)
+{
+    listDel(entry);
+    entry->wheel_ = nullptr;
+    --size_;
+}
+
+void TimingWheel::place(Entry *entry)
+{
+    uint64_t expire = entry->expire_;
+    uint64_t delta = expire > current_ ? expire - current_ : 0;
+    Node *head;
+    if (delta < kRootSize)
+    {
+        head = &root_[(delta == 0 ? current_ : expire) & (kRootSize - 1)];
+    }
+    else
+    {
+        int level = 0;
+        int shift = kRootBits;
+        while (level < kLevels - 1 && delta >= (1ULL << (shift + kLevelBits)))
+        {
+            ++level;
+            shift += kLevelBits;
+        }
+        head = &levels_[level][(expire >> shift) & (kLevelSize - 1)];
+    }
+    listAddTail(head, entry);
+}
+
+int TimingWheel::cascade(int level, int index)
+{
+    Node list;
+    listSplice(&levels_[level][index], &list);
+    while (list.next != &list)
+    {
+        Entry *entry = static_cast<Entry *>(list.next);
+        listDel(entry);
+        place(entry);
+    }
+    return index;
+}
+
+void TimingWheel::tick()
+{
+    int index = static_cast<int>(current_ & (kRootSize - 1));
+    if (index == 0)
+    {
+        // level0转完一圈，依次把高层当前槽里的节点降级
+        int level = 0;
+        int shift = kRootBits;
+        while (level < kLevels && cascade(level, static_cast<int>((current_ >> shift) & (kLevelSize - 1))) == 0)
+        {
+            ++level;
+            shift += kLevelBits;
+        }
+    }
+
+    // 先把到期的槽转移到局部链表，回调里面add/remove其他entry不会影响遍历
+    Node expired;
+    listSplice(&root_[index], &expired);
+    ++current_;
+
+    while (expired.next != &expired)
+    {
+        Entry *entry = static_cast<Entry *>(expired.next);
+        unlink(entry);
+        if (entry->callback_)
+        {
+            entry->callback_();
+        }
+    }
+}
+
+uint64_t TimingWheel::elapsedTicks() const
+{
+    int64_t elapsed = Timestamp::monotonic().microSecondsSinceEpoch() - startTime_;
+    if (elapsed < 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(elapsed / (tickSeconds_ * Timestamp::kMicroSecondsPerSecond));
+}
+
+void TimingWheel::onTimer()
+{
+    // loop繁忙时定时器可能延迟，按照实际经过的时间补齐tick
+    uint64_t target = elapsedTicks();
+    while (current_ < target && size_ > 0)
+    {
+        tick();
+    }
+    if (size_ == 0)
+    {
+        stopTimer();
+    }
+}
+
+void TimingWheel::startTimer()
+{
+    // 定时器没跑说明时间轮是空的，直接追上当前时间
+    uint64_t target = elapsedTicks();
+    if (target > current_)
+    {
+        current_ = target;
+    }
+    timerRunning_ = true;
+    timerId_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTimer, this));
+}
+
+void TimingWheel::stopTimer()
+{
+    if (timerRunning_)
+    {
+        loop_->cancel(timerId_);
+        timerRunning_ = false;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "timer_id.h"
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+/**
+ * @brief 分层时间轮 用于大量连接的空闲超时/请求超时
+ * 每个EventLoop一个，只能在loop线程中使用
+ * 插入、刷新、删除、到期都是O(1)，不像TimerQueue每次刷新都是O(log n)
+ *
+ *   level0: 256个槽 每槽一个tick
+ *   level1~3: 各64个槽 每个槽覆盖下一层一整圈
+ * 低层转完一圈时，把高层当前槽里的节点重新分配到低层（cascade）
+ */
+class TimingWheel : noncopyable
+{
+public:
+    using Callback = std::function<void()>;
+
+    // 双向循环链表节点，槽的表头也是一个Node
+    struct Node
+    {
+        Node *prev = nullptr;
+        Node *next = nullptr;
+    };
+
+    /**
+     * @brief 侵入式定时节点 嵌在被管理的对象里面（比如TcpConnection）
+     * 不需要额外分配内存，对象析构时自动从时间轮中摘除
+     */
+    class Entry : private Node, noncopyable
+    {
+    public:
+        Entry() = default;
+        ~Entry();
+
+        void setCallback(Callback cb) { callback_ = std::move(cb); }
+        bool linked() const { return wheel_ != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        uint64_t expire_ = 0; // 到期的tick
+        TimingWheel *wheel_ = nullptr;
+        Callback callback_;
+    };
+
+    // tickSeconds 时间轮的精度
+    explicit TimingWheel(EventLoop *loop, double tickSeconds = kDefaultTickSeconds);
+    ~TimingWheel();
+
+    /**
+     * @brief 插入或刷新entry，timeout秒后到期执行entry的回调
+     * 已经在时间轮中的entry会被移动到新的槽里
+     */
+    void add(Entry *entry, double timeout);
+    void remove(Entry *entry);
+
+    size_t size() const { return size_; }
+    double tickSeconds() const { return tickSeconds_; }
+
+    static constexpr double kDefaultTickSeconds = 0.1;
+
+private:
+    static const int kRootBits = 8;
+    static const int kLevelBits = 6;
+    static const int kRootSize = 1 << kRootBits;
+    static const int kLevelSize = 1 << kLevelBits;
+    static const int kLevels = 3; // level0之外的层数
+    static const uint64_t kMaxTicks = (1ULL << (kRootBits + kLevels * kLevelBits)) - 1;
+
+    // 按照expire_放入对应层的槽
+    void place(Entry *entry);
+    void unlink(Entry *entry);
+    // 把level层index槽中的节点重新分配到低层，返回index
+    int cascade(int level, int index);
+
+    // 由定时器驱动，按照实际流逝的时间推进current_
+    void onTimer();
+    void tick();
+
+    void startTimer();
+    void stopTimer();
+
+    uint64_t elapsedTicks() const;
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    const int64_t startTime_; // 时间轮创建时间 us
+    uint64_t current_;        // 当前tick
+    size_t size_;
+
+    Node root_[kRootSize];
+    Node levels_[kLevels][kLevelSize];
+
+    bool timerRunning_;
+    TimerId timerId_;
+};